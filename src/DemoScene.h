@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <gtc/matrix_transform.hpp>
 
 #include "util/Scene.h"
@@ -8,12 +9,26 @@
 #include "wrapper/FrameBufferObject.h"
 #include "util/Quad.h"
 #include "wrapper/Model.h"
+#include "wrapper/UniformBuffer.h"
+#include "wrapper/GpuTimer.h"
+#include "wrapper/GpuProfiler.h"
+#include "wrapper/ShaderPermutations.h"
+#include "wrapper/FrameCapture.h"
+#include "util/Noise.h"
+#include "util/CameraPath.h"
 
 #include "shaders/GBufferShader.h"
 #include "shaders/DOFShaderSimple.h"
 #include "shaders/DOFShaderAdvanced.h"
 #include "shaders/DOFShaderShaped.h"
+#include "shaders/DOFTileShader.h"
+#include "shaders/DOFHalfResShader.h"
 #include "shaders/SSAOShader.h"
+#include "shaders/HBAOShader.h"
+#include "shaders/SSAOBlurShader.h"
+#include "shaders/DepthDownsampleShader.h"
+#include "shaders/InterleaveShader.h"
+#include "shaders/TemporalShader.h"
 #include "shaders/DeferredShader.h"
 #include "shaders/PostShader.h"
 #include "shaders/DebugShader.h"
@@ -22,36 +37,68 @@
 
 class DemoScene : public Scene {
     
-    Shader &gShader = getGBufferShader();
+    GBufferLayout gBufferLayout;
     Model bokehTest = { platformPath("assets/test/test.obj") };
     Model model = { platformPath("assets/littlest_tokyo/scene.obj") };
     Quad billboard;
-    Shader& dofSimpleShader = getDofShaderSimple();
-    Shader& dofAdvancedShader = getDOFShaderAdvanced();
-    Shader& dofShapedShader = getDofShaderShape();
-    Shader& ssaoShader = getSsaoShader();
-    Shader& deferredShader = getDeferredShader();
-    Shader& postShader = getPostShader();
-
-    Shader* currentDofShader = &dofSimpleShader;
+    ShaderPermutations& dofSimpleShader = getDofShaderSimple();
+    ShaderPermutations& dofAdvancedShader = getDOFShaderAdvanced();
+    ShaderPermutations& dofShapedShader = getDofShaderShape();
+    ShaderPermutations& postShader = getPostShader();
+
+    ShaderPermutations* currentDofShader = &dofSimpleShader;
+    bool specializeShaders = true; // Compile the sample counts and post features into the shaders
     int currentModel = 0;
 
+    CameraPath cameraPath; // Recorded for --benchmark
+    float cameraPathStart = 0.f;
+
+    bool captureScreenshot = false;
+    bool captureSequence = false;
+    bool captureExr = false;
+    int captureFrame = 0;
+
     FrameBufferObject gFbo = {
+        [this](FrameBufferObject::FrameBufferConfig& c) {
+            gBufferLayout.configure(c);
+        }
+    };
+
+    // Linear depth at the ssao resolution
+    FrameBufferObject ssaoDepthFbo = {
         [](FrameBufferObject::FrameBufferConfig& c) {
-            c.depth = true;
-            c.addRGB16F("gPosition");
-            c.addRGB16F("gNormal");
-            c.addRGBA8("gColor");
+            c.addR32F("ssaoDepth");
         }
     };
 
-    // Holds the unblurred ssao value
+    // Holds the ssao value, blurred after the bilateral blur
     FrameBufferObject ssaoFbo = {
         [](FrameBufferObject::FrameBufferConfig& c) {
             c.addR8("ssaoPass", 0, 0, GL_LINEAR);
         }
     };
 
+    // 4x4 atlas of the ssao depth for the interleaved mode, every layer is a quarter resolution
+    FrameBufferObject ssaoDepthAtlasFbo = {
+        [](FrameBufferObject::FrameBufferConfig& c) {
+            c.addR32F("ssaoDepth");
+        }
+    };
+
+    // The interleaved ssao before it gets put back together into ssaoFbo
+    FrameBufferObject ssaoAtlasFbo = {
+        [](FrameBufferObject::FrameBufferConfig& c) {
+            c.addR8("ssaoAtlas");
+        }
+    };
+
+    // Intermediate result between the horizontal and vertical blur
+    FrameBufferObject ssaoBlurFbo = {
+        [](FrameBufferObject::FrameBufferConfig& c) {
+            c.addR8("ssaoBlurred", 0, 0, GL_LINEAR);
+        }
+    };
+
     // Shading and ao is applied here, the zbuffer is also scaled into linear space
     FrameBufferObject deferredFbo = {
         [](FrameBufferObject::FrameBufferConfig& c) {
@@ -63,11 +110,108 @@ class DemoScene : public Scene {
     FrameBufferObject dofFbo = {
         [](FrameBufferObject::FrameBufferConfig& c) {
             c.addRGBA8("dofPass", 0, 0, GL_LINEAR);
+            c.addStencil(); // Holds the tile classes
+        }
+    };
+
+    // Min and max coc of every tile and the same spread to the neighbours
+    FrameBufferObject dofTileFbo = {
+        [](FrameBufferObject::FrameBufferConfig& c) {
+            c.addRG16F("tileCoc");
         }
     };
+    FrameBufferObject dofTileDilateFbo = {
+        [](FrameBufferObject::FrameBufferConfig& c) {
+            c.addRG16F("dilatedCoc");
+        }
+    };
+
+    // Half resolution copy of the shaded image and distance, named like the full resolution ones
+    FrameBufferObject dofDownsampleFbo = {
+        [](FrameBufferObject::FrameBufferConfig& c) {
+            c.addRGBA8("shadedPass");
+            c.addR16F("linearDistance");
+        }
+    };
+
+    // The DOF at half resolution before it's blended into dofFbo
+    FrameBufferObject dofHalfFbo = {
+        [](FrameBufferObject::FrameBufferConfig& c) {
+            c.addRGBA8("dofHalf");
+            c.addStencil();
+        }
+    };
+
+    bool dofTiles = true, dofHalfRes = false;
+    bool fusePost = true; // The last DOF pass applies the post effects, see fuses()
+
+    /**
+     * Sample positions and vignette of the post pass, baked when the lens changes
+     */
+    FrameBufferObject lensMapFbo = {
+        [](FrameBufferObject::FrameBufferConfig& c) {
+            c.addRGBA32F("lensUv");
+            c.addR16F("lensVignette");
+        }
+    };
+    std::array<float, 8> lensMapSettings = {}; // What the lens map was baked with
+    GLuint lensMapProgram = 0; // A hot reload swaps the program, which needs a new bake too
+    bool lensMapDirty = true;
+    int lensMapBakes = 0;
+    bool postFused = false; // Whether it did in the last frame
+    float dofSmallCoc = 4.f;
+    int dofCheapSamples = 16;
+    GpuTimer dofTimer;
+
+    /**
+     * Accumulated results of the last frames, the one of the current frame is written
+     * while the other one is read as history. Named like the passes they replace
+     */
+    FrameBufferObject ssaoHistoryFbos[2] = {
+        { [](FrameBufferObject::FrameBufferConfig& c) { c.addR16F("ssaoPass", 0, 0, GL_LINEAR); } },
+        { [](FrameBufferObject::FrameBufferConfig& c) { c.addR16F("ssaoPass", 0, 0, GL_LINEAR); } }
+    };
+    FrameBufferObject dofHistoryFbos[2] = {
+        { [](FrameBufferObject::FrameBufferConfig& c) { c.addRGBA16F("dofPass", 0, 0, GL_LINEAR); } },
+        { [](FrameBufferObject::FrameBufferConfig& c) { c.addRGBA16F("dofPass", 0, 0, GL_LINEAR); } }
+    };
+
+    bool ssaoTemporal = false, dofTemporal = false, temporalClamp = true;
+    float temporalFeedback = 0.9f;
+    int historyFrames = 0; // Frames since the history was reset
 
     float ssaoScale = 0.5f, ssaoStrength = 1.f, ssaoRadius = 0.3f, ssaoBias = 0.025f;
-    int ssaoSamples = 32, ssaoBlur = 1;
+    int ssaoSamples = 16, ssaoBlur = 1;
+    bool ssaoBilateral = true, ssaoLinearSampling = true, ssaoInterleaved = true;
+    float ssaoSharpness = 16.f;
+
+    enum AoMethod { AO_HEMISPHERE = 0, AO_HORIZON, AO_METHODS };
+    int aoMethod = AO_HEMISPHERE;
+    int hbaoDirections = 4, hbaoSteps = 4;
+    GpuTimer aoTimers[AO_METHODS]; // Only the active method gets measured
+
+    // Sample kernel, only uploaded again when the sample count changes
+    UniformBuffer ssaoKernel = {
+        SSAO_MAX_SAMPLES * sizeof(glm::vec4), SSAO_KERNEL_BINDING, FramePacer::MAX_FRAMES + 1
+    };
+    int ssaoKernelSize = 0;
+
+    // Bokeh offsets of the shaped DOF, one kernel for the full and one for the cheap sample count
+    UniformBuffer bokehKernel = {
+        BOKEH_KERNEL_SAMPLES * sizeof(glm::vec4), BOKEH_KERNEL_BINDING, FramePacer::MAX_FRAMES + 1
+    };
+    int bokehIterations[2] = { -1, -1 }, bokehBlades[2] = { -1, -1 }, bokehSizes[2] = {};
+
+    std::vector<unsigned char> blueNoise = generateBlueNoise(64);
+    std::shared_ptr<Texture> ssaoNoise = std::make_shared<Texture>(64, 64, TextureConfig{
+        "ssaoNoise", GL_R8, GL_RED, GL_UNSIGNED_BYTE, GL_NEAREST, GL_NEAREST,
+        GL_REPEAT, GL_REPEAT, GL_TEXTURE_2D, blueNoise.data()
+    });
+
+    // Texels between the points of the grain noise, more are smoother
+    int grainCellSize = 4;
+    std::vector<unsigned char> grainData;
+    std::shared_ptr<Texture> grainNoise;
 
     std::shared_ptr<Texture> debugFbo = nullptr;
     bool debugRed = false;
@@ -77,14 +221,60 @@ public:
     DemoScene(int w, int h) {
         camera = getTestCam2();
         DemoScene::onResize(w, h);
+        createGrainNoise();
+
+        // Only issues the compiles, so the driver can work on all of them at once until their first use
+        getGBufferShader(gBufferLayout);
+        getDepthDownsampleShader(gBufferLayout);
+        getSsaoShader(gBufferLayout);
+        getHbaoShader(gBufferLayout);
+        getDeferredShader(gBufferLayout);
+        getSsaoBlurShader();
+        getInterleaveShader();
+        getTemporalShader();
+        getDofTileShader();
+        getDofTileDilateShader();
+        getDofClassifyShader();
+        getDofDownsampleShader();
+        getDofCompositeShader();
+        getLensMapShader();
+        getDebugShader();
     }
 
     void draw() override {
+        PROFILE_SCOPE("DemoScene::draw");
         glm::mat4 projection = camera.getProjectionMatrix(width / height);
         glm::mat4 view = camera.getViewMatrix();
         glm::mat4 modelMatrix = glm::mat4(1.0f);
+        Shader& gShader = getGBufferShader(gBufferLayout);
+        Shader& ssaoShader = aoMethod == AO_HORIZON ? getHbaoShader(gBufferLayout) : getSsaoShader(gBufferLayout);
+        Shader& deferredShader = getDeferredShader(gBufferLayout);
+
+        // The noise gets shifted by the golden ratio every frame so the history converges
+        const float frameOffset = std::fmod(float(frame) * 0.618034f, 1.f);
+        const int current = frame & 1;
+        const glm::mat4 viewToPreviousClip = previousProjection * previousView * glm::inverse(view);
+        Shader& temporalShader = getTemporalShader();
+        const auto accumulate = [&](
+            const std::shared_ptr<Texture>& input, const std::shared_ptr<Texture>& history,
+            const std::shared_ptr<Texture>& depth
+        ) {
+            temporalShader.use();
+            temporalShader.setTexture("current", input, 0);
+            temporalShader.setTexture("history", history, 1);
+            temporalShader.setTexture("depth", depth, 2);
+            temporalShader.setMat4("projection", projection);
+            temporalShader.setMat4("viewToPreviousClip", viewToPreviousClip);
+            temporalShader.setFloat("feedback", temporalFeedback);
+            temporalShader.setBool("clampHistory", temporalClamp);
+            temporalShader.setBool("reset", historyFrames == 0);
+            billboard.draw();
+        };
+
+        GpuProfiler& profiler = getGpuProfiler();
 
         // GBuffer pass
+        profiler.mark("G-Buffer");
         gFbo.draw([&]() {
             gShader.use();
             gShader.setMat4("model", modelMatrix);
@@ -93,69 +283,448 @@ public:
             (currentModel == 0 ? model : bokehTest).draw(gShader);
         });
 
-        // SSAO pass at half res
-        ssaoFbo.draw([&]() {
-            ssaoShader.use(gFbo.getTextures());
+        // Linear depth at the resolution of the SSAO
+        profiler.mark("SSAO");
+        ssaoDepthFbo.draw([&]() {
+            Shader& downsampleShader = getDepthDownsampleShader(gBufferLayout);
+            downsampleShader.use(gFbo.getTextures());
+            downsampleShader.setMat4("projection", projection);
+            downsampleShader.setFloat("zFar", camera.farPlane);
+            downsampleShader.setVec2(
+                "pixelSize", 1.f / ssaoDepthFbo.getWidth(), 1.f / ssaoDepthFbo.getHeight()
+            );
+            billboard.draw();
+        });
+
+        if (ssaoKernelSize != ssaoSamples) {
+            const std::vector<glm::vec4> kernel = getSsaoKernel(ssaoSamples);
+            ssaoKernel.update(kernel.data(), kernel.size() * sizeof(glm::vec4));
+            ssaoKernelSize = ssaoSamples;
+        }
+
+        // SSAO pass at half res, or split into 4x4 layers in the interleaved mode
+        const int ssaoLayerWidth = ssaoDepthAtlasFbo.getWidth() / 4;
+        const int ssaoLayerHeight = ssaoDepthAtlasFbo.getHeight() / 4;
+        Shader& interleaveShader = getInterleaveShader();
+        const auto interleave = [&](const std::shared_ptr<Texture>& input, bool deinterleave) {
+            interleaveShader.use();
+            interleaveShader.setTexture("interleaveInput", input, 0);
+            interleaveShader.setBool("deinterleave", deinterleave);
+            interleaveShader.setIVec2("layerSize", ssaoLayerWidth, ssaoLayerHeight);
+            billboard.draw();
+        };
+        const auto renderSsao = [&](const Textures& textures) {
+            ssaoShader.use(textures);
+            ssaoShader.setTexture("ssaoNoise", ssaoNoise, int(textures.size()));
             ssaoShader.setFloat("strength", ssaoStrength);
             ssaoShader.setFloat("radius", ssaoRadius);
             ssaoShader.setFloat("bias", ssaoBias);
             ssaoShader.setInt("count", ssaoSamples);
+            ssaoShader.setInt("directions", hbaoDirections);
+            ssaoShader.setInt("steps", hbaoSteps);
             ssaoShader.setMat4("projection", projection);
+            ssaoShader.setBool("interleaved", ssaoInterleaved);
+            ssaoShader.setFloat("frameOffset", ssaoTemporal ? frameOffset : 0.f);
+            ssaoShader.setIVec2("layerSize", ssaoLayerWidth, ssaoLayerHeight);
+            ssaoShader.setVec2("ssaoSize", float(ssaoFbo.getWidth()), float(ssaoFbo.getHeight()));
             billboard.draw();
+        };
+        aoTimers[aoMethod].measure([&]() {
+            if (ssaoInterleaved) {
+                ssaoDepthAtlasFbo.draw([&]() {
+                    interleave(ssaoDepthFbo.getTextures()[0], true);
+                });
+                ssaoAtlasFbo.draw([&]() {
+                    renderSsao(ssaoDepthAtlasFbo.getTextures(gFbo.getTextures()));
+                });
+                ssaoFbo.draw([&]() {
+                    interleave(ssaoAtlasFbo.getTextures()[0], false);
+                });
+            } else {
+                ssaoFbo.draw([&]() {
+                    renderSsao(ssaoDepthFbo.getTextures(gFbo.getTextures()));
+                });
+            }
         });
 
+        profiler.mark("SSAO Filter");
+        FrameBufferObject* ssaoResult = &ssaoFbo;
+        if (ssaoTemporal) {
+            ssaoResult = &ssaoHistoryFbos[current];
+            ssaoResult->draw([&]() {
+                accumulate(
+                    ssaoFbo.getTextures()[0], ssaoHistoryFbos[1 - current].getTextures()[0],
+                    ssaoDepthFbo.getTextures()[0]
+                );
+            });
+        }
+
+        if (ssaoBlur > 0) {
+            // Separable depth aware blur, horizontal into ssaoBlurFbo and back vertically
+            Shader& blurShader = getSsaoBlurShader();
+            const auto blur = [&](const std::shared_ptr<Texture>& input, float x, float y) {
+                blurShader.use();
+                blurShader.setTexture("ssaoInput", input, 0);
+                blurShader.setTexture("ssaoDepth", ssaoDepthFbo.getTextures()[0], 1);
+                blurShader.setVec2("direction", x, y);
+                blurShader.setInt("radius", ssaoBlur);
+                blurShader.setFloat("sharpness", ssaoSharpness);
+                blurShader.setBool("linearSampling", ssaoLinearSampling);
+                billboard.draw();
+            };
+            ssaoBlurFbo.draw([&]() {
+                blur(ssaoResult->getTextures()[0], 1.f / ssaoFbo.getWidth(), 0.f);
+            });
+            ssaoFbo.draw([&]() {
+                blur(ssaoBlurFbo.getTextures()[0], 0.f, 1.f / ssaoFbo.getHeight());
+            });
+            ssaoResult = &ssaoFbo;
+        }
+
         /**
          * Deferred shading and applying+filtering SSAO
          * and converting the depth buffer in linear space
          */
+        profiler.mark("Deferred");
         deferredFbo.draw([&]() {
-            deferredShader.use(ssaoFbo.getTextures(gFbo.getTextures()));
-            deferredShader.setInt("blur", ssaoBlur);
+            deferredShader.use(ssaoDepthFbo.getTextures(ssaoResult->getTextures(gFbo.getTextures())));
+            deferredShader.setBool("bilateral", ssaoBilateral);
             deferredShader.setFloat("zNear", camera.nearPlane);
             deferredShader.setFloat("zFar", camera.farPlane);
+            deferredShader.setMat4("projection", projection);
+            deferredShader.setVec4("background", background);
             billboard.draw();
         });
 
-        const auto renderDof = [&]() {
-            currentDofShader->use(deferredFbo.getTextures());
-            currentDofShader->setInt("apertureBlades", camera.apertureBlades);
-            currentDofShader->setInt("iterations", camera.dofSamples);
-            currentDofShader->setFloat("focus", camera.focusDistance);
-            currentDofShader->setFloat("focalLength", camera.focalLength);
-            currentDofShader->setFloat("aperture", camera.aperture);
-            currentDofShader->setVec2(
+        // The DOF either reads the full resolution image or the downsampled one
+        const Textures& dofSource = dofHalfRes ? dofDownsampleFbo.getTextures() : deferredFbo.getTextures();
+
+        /**
+         * Vignette, grain and exposure of getPostChunk(), shared by the post pass and the fused DOF passes
+         */
+        const auto setPost = [&](const Shader& shader, bool fused) {
+            shader.setBool("fusedPost", fused);
+            shader.setFloat("vignetteStrength", camera.vignetteStrength);
+            shader.setFloat("vignetteFalloff", camera.vignetteFalloff);
+            shader.setFloat("vignetteDesaturation", camera.vignetteDesaturation);
+            shader.setFloat("outputAspectRatio", camera.aspectRatio);
+            shader.setFloat("grain", camera.grain);
+            shader.setFloat("grainSize", camera.grainSize);
+            shader.setTexture("grainNoise", grainNoise, 7); // Above the textures of all the passes
+            // Low discrepancy offsets, so consecutive frames never reuse a part of the noise
+            shader.setVec2(
+                "grainOffset", std::fmod(float(frame) * 0.7548777f, 1.f), std::fmod(float(frame) * 0.5698403f, 1.f)
+            );
+            shader.setFloat("exposure", camera.exposure);
+        };
+        const auto addPostDefines = [&](ShaderDefines& defines, bool fused) {
+            defines["FUSED_POST"] = ShaderPermutations::toDefine(fused);
+            if (fused) {
+                defines["VIGNETTE"] = ShaderPermutations::toDefine(camera.vignetteStrength != 0.f);
+                defines["GRAIN"] = ShaderPermutations::toDefine(camera.grain > 0.001f);
+            }
+        };
+
+        postFused = fuses();
+        const bool fuseDof = postFused && !dofHalfRes; // Otherwise the composite is the last pass
+
+        const auto renderDof = [&](int iterations) {
+            const int slot = iterations == camera.dofSamples ? 0 : 1;
+            if (currentDofShader == &dofShapedShader) {
+                // Only rebuilt when the samples or blades change
+                if (bokehIterations[slot] != iterations || bokehBlades[slot] != camera.apertureBlades) {
+                    std::vector<glm::vec2> kernel = getBokehKernel(iterations, camera.apertureBlades);
+                    // Two samples per vec4, so a kernel takes up half its slot
+                    bokehKernel.update(kernel.data(), kernel.size() * sizeof(glm::vec2),
+                        slot * BOKEH_KERNEL_SAMPLES * sizeof(glm::vec2));
+                    bokehIterations[slot] = iterations;
+                    bokehBlades[slot] = camera.apertureBlades;
+                    bokehSizes[slot] = int(kernel.size());
+                }
+            }
+
+            ShaderDefines defines;
+            if (specializeShaders) {
+                if (currentDofShader == &dofShapedShader) {
+                    defines["KERNEL_SIZE"] = ShaderPermutations::toDefine(bokehSizes[slot]);
+                } else {
+                    defines["ITERATIONS"] = ShaderPermutations::toDefine(iterations);
+                }
+                if (currentDofShader == &dofAdvancedShader) {
+                    defines["BLADES"] = ShaderPermutations::toDefine(camera.apertureBlades);
+                }
+                addPostDefines(defines, fuseDof);
+            }
+            const Shader& dofShader = currentDofShader->getReady(defines);
+            dofShader.use(dofSource);
+            dofShader.setInt("kernelOffset", slot * BOKEH_KERNEL_SAMPLES);
+            dofShader.setInt("kernelSize", bokehSizes[slot]);
+            dofShader.setInt("apertureBlades", camera.apertureBlades);
+            dofShader.setInt("iterations", iterations);
+            dofShader.setFloat("focus", camera.focusDistance);
+            dofShader.setFloat("focalLength", camera.focalLength);
+            dofShader.setFloat("aperture", camera.aperture);
+            dofShader.setVec2(
                 "pixelSize", 1.f / float(width), 1.f / float(height)
             );
-            currentDofShader->setFloat("bokehSqueeze", camera.bokehSqueeze);
-            currentDofShader->setFloat("bokehSqueezeFalloff", camera.bokehSqueezeFalloff);
+            dofShader.setFloat("bokehSqueeze", camera.bokehSqueeze);
+            dofShader.setFloat("bokehSqueezeFalloff", camera.bokehSqueezeFalloff);
+            dofShader.setFloat("frameOffset", dofTemporal ? frameOffset : 0.f);
+            setPost(dofShader, fuseDof);
             billboard.draw();
         };
 
+        // How far each shader really reaches, so the tile classes and blending are conservative
+        float cocScale = 10000.f, maxCoc = 10000.f, reach = 0.f;
+        if (currentDofShader == &dofAdvancedShader) {
+            maxCoc = reach = 20.f; // MAX_BLUR_SIZE
+        } else if (currentDofShader == &dofShapedShader) {
+            maxCoc = reach = camera.focalLength / camera.aperture * 50.f *
+                std::max(1.f, std::abs(1.f + camera.bokehSqueeze));
+            cocScale = 1000.f * maxCoc;
+        } // The simple one only gathers with the coc of the center
+
+        const auto setCoc = [&](const Shader& shader) {
+            shader.setFloat("focus", camera.focusDistance);
+            shader.setFloat("focalLength", camera.focalLength);
+            shader.setFloat("aperture", camera.aperture);
+            shader.setFloat("cocScale", cocScale);
+            shader.setFloat("maxCoc", maxCoc);
+        };
+
+        /**
+         * Only runs the expensive DOF where it's needed, the tiles get sorted into classes
+         * which are marked in the stencil buffer of the framebuffer that's drawn to
+         */
+        const auto renderDofTiled = [&]() {
+            const auto classify = [&](int minClass, bool fused) {
+                ShaderDefines defines;
+                if (specializeShaders) {
+                    addPostDefines(defines, fused);
+                }
+                const Shader& classifyShader = getDofClassifyShader().getReady(defines);
+                classifyShader.use(dofTileDilateFbo.getTextures({ dofSource[0] }));
+                classifyShader.setInt("tileSize", DOF_TILE_SIZE);
+                classifyShader.setInt("minClass", minClass);
+                classifyShader.setFloat("smallCoc", dofSmallCoc);
+                setPost(classifyShader, fused);
+                billboard.draw();
+            };
+
+            glEnable(GL_STENCIL_TEST);
+            // Mark the cheap and full classes, the in focus pixels stay 0
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+            for (int c = 1; c <= 2; c++) {
+                glStencilFunc(GL_ALWAYS, c, 0xFF);
+                classify(c, false);
+            }
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+            glStencilFunc(GL_EQUAL, 0, 0xFF);
+            classify(0, fuseDof); // Copy
+            glStencilFunc(GL_EQUAL, 1, 0xFF);
+            renderDof(std::min(camera.dofSamples, dofCheapSamples));
+            glStencilFunc(GL_EQUAL, 2, 0xFF);
+            renderDof(camera.dofSamples);
+            glDisable(GL_STENCIL_TEST);
+        };
+
+        /**
+         * Null draws to the screen, which only the fused post does
+         */
+        const auto renderDofInto = [&](FrameBufferObject* target) {
+            if (dofTiles) {
+                dofTileFbo.draw([&]() {
+                    Shader& tileShader = getDofTileShader();
+                    tileShader.use();
+                    tileShader.setTexture("linearDistance", dofSource[1], 0);
+                    tileShader.setInt("tileSize", DOF_TILE_SIZE);
+                    setCoc(tileShader);
+                    billboard.draw();
+                });
+                dofTileDilateFbo.draw([&]() {
+                    Shader& dilateShader = getDofTileDilateShader();
+                    dilateShader.use(dofTileFbo.getTextures());
+                    // The reach is in full resolution pixels
+                    const float tilePixels = float(DOF_TILE_SIZE) * (dofHalfRes ? 2.f : 1.f);
+                    dilateShader.setInt("dilation", std::min(4, int(std::ceil(reach / tilePixels))));
+                    billboard.draw();
+                });
+            }
+            const auto dof = [&]() {
+                if (dofTiles) {
+                    renderDofTiled();
+                } else {
+                    renderDof(camera.dofSamples);
+                }
+            };
+            if (target != nullptr) {
+                target->draw(dof);
+                return;
+            }
+            // The depth test of the screen would reject every pass after the first
+            glClear(GL_STENCIL_BUFFER_BIT);
+            glDisable(GL_DEPTH_TEST);
+            dof();
+            glEnable(GL_DEPTH_TEST);
+        };
+
         if (debugFbo == nullptr) {
             // Do post effects
-            dofFbo.draw(renderDof);
-            postShader.use(dofFbo.getTextures());
-            postShader.setFloat("vignetteStrength", camera.vignetteStrength);
-            postShader.setFloat("vignetteFalloff", camera.vignetteFalloff);
-            postShader.setFloat("aspectRatio", camera.aspectRatio);
-            postShader.setFloat("vignetteDesaturation", camera.vignetteDesaturation);
-            postShader.setFloat("dispersion", camera.dispersionStrength);
-            postShader.setFloat("dispersionFalloff", camera.dispersionFalloff);
-            postShader.setFloat("barrelDistortionFalloff", camera.barrelDistortionFalloff);
-            postShader.setFloat("barrelDistortion", camera.barrelDistortion);
-            postShader.setFloat("crop", camera.sensorCrop);
-            postShader.setFloat("grain", camera.grain);
-            postShader.setFloat("grainSize", camera.grainSize);
-            postShader.setFloat("time", time);
-            postShader.setFloat("exposure", camera.exposure);
+            profiler.mark("DOF");
+            dofTimer.measure([&]() {
+                if (!dofHalfRes) {
+                    renderDofInto(fuseDof ? nullptr : &dofFbo);
+                    return;
+                }
+                // Gather at half resolution and blend it back over the sharp image
+                dofDownsampleFbo.draw([&]() {
+                    Shader& downsampleShader = getDofDownsampleShader();
+                    downsampleShader.use();
+                    downsampleShader.setTexture("fullColor", deferredFbo.getTextures()[0], 0);
+                    downsampleShader.setTexture("fullDistance", deferredFbo.getTextures()[1], 1);
+                    setCoc(downsampleShader);
+                    billboard.draw();
+                });
+                renderDofInto(&dofHalfFbo);
+                const auto composite = [&]() {
+                    ShaderDefines defines;
+                    if (specializeShaders) {
+                        addPostDefines(defines, postFused);
+                    }
+                    const Shader& compositeShader = getDofCompositeShader().getReady(defines);
+                    compositeShader.use();
+                    compositeShader.setTexture("fullColor", deferredFbo.getTextures()[0], 0);
+                    compositeShader.setTexture("fullDistance", deferredFbo.getTextures()[1], 1);
+                    compositeShader.setTexture("halfDof", dofHalfFbo.getTextures()[0], 2);
+                    compositeShader.setTexture("halfDistance", dofDownsampleFbo.getTextures()[1], 3);
+                    setCoc(compositeShader);
+                    setPost(compositeShader, postFused);
+                    billboard.draw();
+                };
+                if (postFused) {
+                    composite();
+                } else {
+                    dofFbo.draw(composite);
+                }
+            });
+            FrameBufferObject* dofResult = &dofFbo;
+            if (dofTemporal) {
+                dofResult = &dofHistoryFbos[current];
+                dofResult->draw([&]() {
+                    accumulate(
+                        dofFbo.getTextures()[0], dofHistoryFbos[1 - current].getTextures()[0],
+                        deferredFbo.getTextures()[1]
+                    );
+                });
+            }
+            if (!postFused) {
+                bakeLensMap();
+                ShaderDefines postDefines;
+                if (specializeShaders) {
+                    postDefines["DISPERSION"] = ShaderPermutations::toDefine(std::abs(camera.dispersionStrength) >= 0.001f);
+                    postDefines["VIGNETTE"] = ShaderPermutations::toDefine(camera.vignetteStrength != 0.f);
+                    postDefines["GRAIN"] = ShaderPermutations::toDefine(camera.grain > 0.001f);
+                }
+                const Shader& post = postShader.getReady(postDefines);
+                post.use(dofResult->getTextures());
+                post.setTexture("lensUv", lensMapFbo.getTextures()[0], 1);
+                post.setTexture("lensVignette", lensMapFbo.getTextures()[1], 2);
+                setPost(post, false);
+                post.setFloat("dispersion", camera.dispersionStrength);
+                post.setFloat("crop", camera.sensorCrop);
+            }
         } else {
             // Draw a texture directly to screen
             getDebugShader().use({ debugFbo });
             getDebugShader().setBool("red", debugRed);
             getDebugShader().setFloat("scale", debugScale);
         }
-        billboard.draw();
+        if (!postFused) {
+            profiler.mark("Post");
+            billboard.draw();
+        }
 
+        if (captureScreenshot || captureSequence) {
+            capture();
+        }
+
+        previousView = view;
+        previousProjection = projection;
+        frame++;
+        historyFrames++;
+    }
+
+    /**
+     * The tileable film grain, GRAIN_CELLS points of value noise in each direction
+     */
+    void createGrainNoise() {
+        const int size = GRAIN_CELLS * grainCellSize;
+        grainData = generateGrainNoise(GRAIN_CELLS, grainCellSize);
+        grainNoise = std::make_shared<Texture>(size, size, TextureConfig{
+            "grainNoise", GL_R8, GL_RED, GL_UNSIGNED_BYTE, GL_LINEAR, GL_LINEAR,
+            GL_REPEAT, GL_REPEAT, GL_TEXTURE_2D, grainData.data()
+        });
+    }
+
+    /**
+     * Redraws the lens map if any of the lens settings or its shader changed since the last time
+     */
+    void bakeLensMap() {
+        const std::array<float, 8> settings = {
+            camera.sensorCrop, camera.aspectRatio,
+            camera.barrelDistortion, camera.barrelDistortionFalloff,
+            camera.dispersionStrength, camera.dispersionFalloff,
+            camera.vignetteStrength, camera.vignetteFalloff
+        };
+        Shader& lensShader = getLensMapShader();
+        if (!lensMapDirty && settings == lensMapSettings && lensShader.getId() == lensMapProgram) { return; }
+        lensMapFbo.draw([&]() {
+            lensShader.use();
+            lensShader.setFloat("crop", camera.sensorCrop);
+            lensShader.setFloat("outputAspectRatio", camera.aspectRatio);
+            lensShader.setFloat("barrelDistortion", camera.barrelDistortion);
+            lensShader.setFloat("barrelDistortionFalloff", camera.barrelDistortionFalloff);
+            lensShader.setFloat("dispersion", camera.dispersionStrength);
+            lensShader.setFloat("dispersionFalloff", camera.dispersionFalloff);
+            lensShader.setFloat("vignetteStrength", camera.vignetteStrength);
+            lensShader.setFloat("vignetteFalloff", camera.vignetteFalloff);
+            billboard.draw();
+        });
+        lensMapSettings = settings;
+        lensMapProgram = lensShader.getId();
+        lensMapDirty = false;
+        lensMapBakes++;
+    }
+
+    /**
+     * Whether the post effects can go into the last DOF pass. Only if none of them reads other pixels
+     * and nothing else needs the DOF result
+     */
+    bool fuses() const {
+        return fusePost && debugFbo == nullptr && !dofTemporal && camera.sensorCrop == 0.f &&
+            camera.barrelDistortion == 0.f && std::abs(camera.dispersionStrength) < 0.001f;
+    }
+
+    /**
+     * Reads back what's on the screen, and the texture picked in FBO Debug as exr
+     */
+    void capture() {
+        FrameCapture& capture = getFrameCapture();
+        const std::string directory = platformPath("capture/");
+        makeDirectory(directory);
+        char number[16];
+        std::snprintf(number, sizeof(number), "%05d", captureFrame++);
+        capture.captureFramebuffer(
+            FrameBufferObject::screen(), int(width), int(height),
+            directory + "frame_" + number + (captureExr ? ".exr" : ".png")
+        );
+        if (debugFbo != nullptr) {
+            capture.captureTexture(*debugFbo, directory + debugFbo->getName() + "_" + number + ".exr");
+        }
+        captureScreenshot = false;
     }
 
     void onEvent(Event& e) override {
@@ -168,13 +737,53 @@ public:
         debugFbo = nullptr;
         Scene::onResize(w, h);
         gFbo.resize(w, h, camera.resolutionScale);
-        ssaoFbo.resize(w, h, ssaoScale * camera.resolutionScale);
+        resizeSsao();
         deferredFbo.resize(w, h, camera.resolutionScale);
-        dofFbo.resize(w, h, camera.resolutionScale);
+        resizeDof();
         camera.aspectRatio = w / float(h);
+        lensMapFbo.resize(w, h); // Post runs at the size of the screen
+        lensMapDirty = true;
         
     }
 
+    /**
+     * The DOF targets, the tiles follow the resolution the DOF runs at
+     */
+    void resizeDof() {
+        const int w = int(width), h = int(height);
+        dofFbo.resize(w, h, camera.resolutionScale);
+        dofDownsampleFbo.resize(w, h, camera.resolutionScale * 0.5f);
+        dofHalfFbo.resize(w, h, camera.resolutionScale * 0.5f);
+        const FrameBufferObject& target = dofHalfRes ? dofHalfFbo : dofFbo;
+        dofTileFbo.resize(
+            (target.getWidth() + DOF_TILE_SIZE - 1) / DOF_TILE_SIZE,
+            (target.getHeight() + DOF_TILE_SIZE - 1) / DOF_TILE_SIZE
+        );
+        dofTileDilateFbo.resize(dofTileFbo.getWidth(), dofTileFbo.getHeight());
+        for (auto& f : dofHistoryFbos) {
+            f.resize(w, h, camera.resolutionScale);
+        }
+        historyFrames = 0;
+    }
+
+    /**
+     * All the ssao targets, the atlases get padded to a multiple of 4
+     */
+    void resizeSsao() {
+        const float s = ssaoScale * camera.resolutionScale;
+        ssaoDepthFbo.resize(int(width), int(height), s);
+        ssaoFbo.resize(int(width), int(height), s);
+        ssaoBlurFbo.resize(int(width), int(height), s);
+        const int atlasWidth = (ssaoFbo.getWidth() + 3) / 4 * 4;
+        const int atlasHeight = (ssaoFbo.getHeight() + 3) / 4 * 4;
+        ssaoDepthAtlasFbo.resize(atlasWidth, atlasHeight);
+        ssaoAtlasFbo.resize(atlasWidth, atlasHeight);
+        for (auto& f : ssaoHistoryFbos) {
+            f.resize(int(width), int(height), s);
+        }
+        historyFrames = 0;
+    }
+
     void debugUi() override {
         const auto helpMaker = [](const char* desc) {
             ImGui::SameLine();
@@ -193,6 +802,12 @@ public:
 
         ImGui::RadioButton("Little Tokyo", &currentModel, 0); ImGui::SameLine();
         ImGui::RadioButton("Bokeh Test", &currentModel, 1);
+
+        bool hotReload = getShaderReloader().isEnabled();
+        if (ImGui::Checkbox("Hot Reload Shaders", &hotReload)) {
+            getShaderReloader().setEnabled(hotReload);
+        }
+        helpMaker(("Writes the built in shaders to " + getShaderReloader().directory + ", saving one of them recompiles it").c_str());
         
         if (ImGui::CollapsingHeader("Camera Settings"), ImGuiTreeNodeFlags_DefaultOpen) {
             if (ImGui::TreeNode("Sensor Settings")) {
@@ -232,6 +847,19 @@ public:
                 }
                 ImGui::SliderInt("Samples", &camera.dofSamples, 0, 512);
                 helpMaker("Depth of field samples per pixel");
+                if (ImGui::Checkbox("Half Resolution", &dofHalfRes)) {
+                    debugFbo = nullptr;
+                    resizeDof();
+                }
+                helpMaker("Gathers at half resolution and blends the result with the sharp image by the circle of confusion");
+                ImGui::Checkbox("Tiles", &dofTiles);
+                helpMaker("Classifies 16x16 tiles by their circle of confusion, in focus tiles are only copied and small blurs use less samples");
+                if (dofTiles) {
+                    ImGui::SliderFloat("Small CoC", &dofSmallCoc, 0.5f, 32.f);
+                    helpMaker("Largest circle of confusion in pixels which still uses the cheap samples");
+                    ImGui::SliderInt("Cheap Samples", &dofCheapSamples, 0, 128);
+                }
+                ImGui::Text("GPU time: %.3f ms", dofTimer.getMs());
                 
                 ImGui::Separator();
                 int e = 0;
@@ -246,6 +874,16 @@ public:
                 if (e == 0) { currentDofShader = &dofSimpleShader; }
                 if (e == 1) { currentDofShader = &dofAdvancedShader; }
                 if (e == 2) { currentDofShader = &dofShapedShader; }
+                ImGui::Checkbox("Specialized Shaders", &specializeShaders);
+                helpMaker("Compiles a shader variant for every sample count and set of post effects, so loops get unrolled and unused effects removed");
+                ImGui::Checkbox("Fused Post", &fusePost);
+                helpMaker("Vignette, grain and exposure in the last DOF pass instead of an own pass. Not with sensor crop, distortion, dispersion or temporal DOF");
+                ImGui::SameLine();
+                ImGui::TextDisabled(postFused ? "(active)" : "(inactive)");
+                ImGui::Text("Lens map bakes: %d", lensMapBakes);
+                helpMaker("Crop, distortion, dispersion and vignette are baked into a texture whenever they change");
+                ImGui::Text("Variants: %d", int(currentDofShader->size() + postShader.size()));
+                ImGui::Text("Programs: %d from cache, %d compiled", getProgramCache().getLoaded(), getProgramCache().getCompiled());
                 ImGui::TreePop();
             }
 
@@ -280,6 +918,10 @@ public:
             if (ImGui::TreeNode("Grain")) {
                 ImGui::SliderFloat("Strength", &camera.grain, 0.f, 1.f);
                 ImGui::SliderFloat("Size", &camera.grainSize, 0.f, 1.f);
+                if (ImGui::SliderInt("Smoothness", &grainCellSize, 1, 8)) {
+                    createGrainNoise();
+                }
+                helpMaker("Texels between the points of the noise texture, 1 only interpolates linearly");
                 ImGui::TreePop();
             }
         }
@@ -290,11 +932,16 @@ public:
         if (ImGui::CollapsingHeader("FBO Debug")) {
             ImGui::Checkbox("Red only", &debugRed); ImGui::SameLine();
             ImGui::SliderFloat("Scale", &debugScale, 0.001f, 2.f);
-            std::vector<FrameBufferObject*> fbos = { &gFbo, &ssaoFbo, &deferredFbo, &dofFbo };
+            std::vector<FrameBufferObject*> fbos = {
+                &gFbo, &ssaoDepthFbo, &ssaoDepthAtlasFbo, &ssaoAtlasFbo, &ssaoFbo, &ssaoBlurFbo,
+                &ssaoHistoryFbos[0], &ssaoHistoryFbos[1], &deferredFbo, &dofFbo, &dofHistoryFbos[0], &dofHistoryFbos[1],
+                &dofTileFbo, &dofTileDilateFbo, &dofDownsampleFbo, &dofHalfFbo
+            };
             int i = 0;
             for (auto& f : fbos) {
                 Textures textures = f->getTextures();
                 for (auto& t : textures) {
+                    if (t->isInteger()) { continue; } // The debug shader can't show them
                     if (debugFbo == nullptr) { debugFbo = t; }
                     bool enabled = debugFbo.get() == t.get();
                     bool was = enabled;
@@ -311,18 +958,146 @@ public:
             debugFbo = nullptr;
         }
 
+        if (ImGui::CollapsingHeader("G-Buffer")) {
+            GBufferLayout layout = gBufferLayout;
+            ImGui::Checkbox("Reconstruct Position", &layout.reconstructPosition);
+            helpMaker("Don't store the position in the G-Buffer, but reconstruct it from the depth buffer");
+            int normals = layout.normals;
+            ImGui::Text("Normals");
+            ImGui::RadioButton("RGB16F", &normals, GBufferLayout::NORMAL_RGB16F); ImGui::SameLine();
+            ImGui::RadioButton("Octahedral RG16", &normals, GBufferLayout::NORMAL_OCT16); ImGui::SameLine();
+            ImGui::RadioButton("Octahedral RG8", &normals, GBufferLayout::NORMAL_OCT8);
+            layout.normals = GBufferLayout::Normals(normals);
+            ImGui::Checkbox("Packed", &layout.packed);
+            helpMaker("Color and octahedral normal in a single RG32UI target, the position is always reconstructed");
+            ImGui::Text("%i bytes per pixel", layout.bytesPerPixel());
+            if (
+                layout.reconstructPosition != gBufferLayout.reconstructPosition ||
+                layout.normals != gBufferLayout.normals || layout.packed != gBufferLayout.packed
+            ) {
+                gBufferLayout = layout;
+                debugFbo = nullptr;
+                gFbo.resize(width, height, camera.resolutionScale);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Temporal Accumulation")) {
+            const bool ssaoWas = ssaoTemporal, dofWas = dofTemporal;
+            ImGui::Checkbox("SSAO", &ssaoTemporal); ImGui::SameLine();
+            ImGui::Checkbox("DOF", &dofTemporal);
+            helpMaker("Changes the noise every frame and blends it with the reprojected last frames, so fewer samples are needed");
+            if (ssaoWas != ssaoTemporal || dofWas != dofTemporal) {
+                historyFrames = 0; // The history of a disabled effect is outdated
+            }
+            ImGui::SliderFloat("History Weight", &temporalFeedback, 0.f, 0.98f);
+            ImGui::Checkbox("Neighbourhood Clamp", &temporalClamp);
+            helpMaker("Limits the history to the colors around the pixel, which avoids ghosting");
+        }
+
+        if (ImGui::CollapsingHeader("GPU Profile")) {
+            GpuProfiler& profiler = getGpuProfiler();
+            ImGui::Checkbox("Record", &profiler.enabled);
+            helpMaker("Timestamps between the passes, read a few frames later so it never waits on the GPU");
+            ImGui::SameLine();
+            if (ImGui::Button("Export CSV")) {
+                profiler.exportCsv(platformPath("gpu_profile.csv"));
+            }
+#ifdef CPU_PROFILER
+            ImGui::SameLine();
+            if (ImGui::Button("Export CPU Trace")) {
+                getCpuProfiler().exportChromeTrace(platformPath("cpu_trace.json"));
+            }
+            helpMaker("Open it in chrome://tracing or ui.perfetto.dev");
+#endif
+            // Keyframes get the time they were added at, so fly through the scene and add them on the way
+            ImGui::Text("Camera path: %d keyframes, %.1f s", int(cameraPath.size()), cameraPath.getDuration());
+            if (ImGui::Button("Add Keyframe")) {
+                if (cameraPath.size() == 0) { cameraPathStart = time; }
+                cameraPath.add(time - cameraPathStart, camera);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Clear")) {
+                cameraPath.clear();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Save Path")) {
+                cameraPath.save(platformPath("camera_path.txt"));
+            }
+            helpMaker("Play it back with --benchmark --path camera_path.txt");
+
+            for (int i = -1; i < profiler.getSectionCount(); i++) {
+                const std::vector<float> values = profiler.getHistory(i);
+                const std::string name = i < 0 ? "Frame" : profiler.getName(i);
+                char average[32];
+                std::snprintf(average, sizeof(average), "%.3f ms", profiler.getAverage(i));
+                ImGui::PlotLines(
+                    name.c_str(), values.data(), int(values.size()), 0, average,
+                    0.f, FLT_MAX, ImVec2(0, i < 0 ? 60.f : 30.f)
+                );
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Frame Pacing")) {
+            FramePacer& pacer = getFramePacer();
+            int mode = pacer.mode;
+            ImGui::RadioButton("Low Latency", &mode, FramePacer::LATENCY); ImGui::SameLine();
+            ImGui::RadioButton("Throughput", &mode, FramePacer::THROUGHPUT);
+            pacer.mode = FramePacer::Mode(mode);
+            helpMaker("Low latency waits for the GPU before every frame, throughput lets the CPU work ahead");
+            if (pacer.mode == FramePacer::THROUGHPUT) {
+                ImGui::SliderInt("Frames in Flight", &pacer.throughputFrames, 1, FramePacer::MAX_FRAMES);
+            }
+            ImGui::Text("Waited %.3f ms for the GPU", pacer.getWaitMs());
+        }
+
+        if (ImGui::CollapsingHeader("Capture")) {
+            if (ImGui::Button("Screenshot")) {
+                captureScreenshot = true;
+            }
+            ImGui::SameLine();
+            ImGui::Checkbox("Record Sequence", &captureSequence);
+            ImGui::SameLine();
+            ImGui::Checkbox("EXR", &captureExr);
+            helpMaker("Written to capture/ in the background, the texture picked in FBO Debug is saved as exr too");
+            ImGui::Text("%d written, %d pending", getFrameCapture().getWritten(), getFrameCapture().getPending());
+        }
+
         if (ImGui::CollapsingHeader("SSAO")) {
+            ImGui::Text("Method");
+            ImGui::RadioButton("Hemisphere", &aoMethod, AO_HEMISPHERE); ImGui::SameLine();
+            ImGui::RadioButton("Horizon Based", &aoMethod, AO_HORIZON);
+            ImGui::Text(
+                "GPU time: hemisphere %.3f ms, horizon %.3f ms",
+                aoTimers[AO_HEMISPHERE].getMs(), aoTimers[AO_HORIZON].getMs()
+            );
+            helpMaker("Only the active method is measured, the other keeps its last value");
             float sscale = ssaoScale;
             ImGui::SliderFloat("Resolution", &sscale, 0.1f, 4.f);
             if (sscale != ssaoScale) {
                 ssaoScale = sscale;
-                ssaoFbo.resize(width, height, ssaoScale);
+                debugFbo = nullptr;
+                resizeSsao();
             }
             ImGui::SliderFloat("Strength", &ssaoStrength, 0.1f, 10.f);
             ImGui::SliderFloat("Radius", &ssaoRadius, 0.01f, 2.f);
             ImGui::SliderFloat("Bias", &ssaoBias, 0.001f, 1.f);
             ImGui::SliderInt("Blur", &ssaoBlur, 0, 32);
-            ImGui::SliderInt("Samples", &ssaoSamples, 1, 256);
+            helpMaker("Radius of the separable depth aware blur");
+            ImGui::SliderFloat("Sharpness", &ssaoSharpness, 0.f, 64.f);
+            helpMaker("How strongly the blur avoids crossing depth edges");
+            ImGui::Checkbox("Linear Sampling", &ssaoLinearSampling);
+            helpMaker("Halves the blur taps by letting the texture filtering combine two texels");
+            ImGui::Checkbox("Bilateral Upsampling", &ssaoBilateral);
+            helpMaker("Depth aware upsampling, avoids halos at lower resolutions");
+            if (aoMethod == AO_HORIZON) {
+                ImGui::SliderInt("Directions", &hbaoDirections, 1, 16);
+                ImGui::SliderInt("Steps", &hbaoSteps, 1, 16);
+                helpMaker("Samples per direction, the bias is used as angle bias");
+            } else {
+                ImGui::SliderInt("Samples", &ssaoSamples, 1, SSAO_MAX_SAMPLES);
+            }
+            ImGui::Checkbox("Interleaved", &ssaoInterleaved);
+            helpMaker("Renders 4x4 quarter resolution layers with one kernel rotation each, which is easier on the texture cache");
         }
     }
 };
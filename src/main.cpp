@@ -6,12 +6,28 @@
 #include <GLFW/glfw3.h>
 
 #include <string>
+#include <cstring>
+#include <cstdio>
 #include <iostream>
 #include <random>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+
+// The image writers are header only, their implementation goes into this file
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define TINYEXR_IMPLEMENTATION
+#include "wrapper/FrameCapture.h"
+#undef STB_IMAGE_WRITE_IMPLEMENTATION
+#undef TINYEXR_IMPLEMENTATION
 
 #include "util/Event.h"
 #include "util/Scene.h"
 #include "DemoScene.h"
+#include "wrapper/Headless.h"
+#include "util/CameraPath.h"
+#include "util/Benchmark.h"
+#include "util/EventRecorder.h"
 
 /**
  * Callbacks
@@ -30,6 +46,39 @@ float lastFrame = 0.0f;
 
 Scene* scene = nullptr;
 
+/**
+ * dof_example --headless [--size 1920x1080] [--frames 60] [--output dir] [--format png|exr]
+ * renders without showing a window and writes every frame
+ * dof_example --benchmark [--path camera.txt] [--warmup 30] [--frames 600] [--json results.json]
+ * plays a camera path headless and writes the timings, by default the whole path at 60 steps per second
+ * --record events.bin saves the input of a session, --replay events.bin plays it back instead of the input
+ * or the camera path, with the frame times and window size of the recording
+ * --trace cpu_trace.json writes the CPU profile at exit, in any mode (needs -DCPU_PROFILER=ON)
+ */
+struct Options {
+    bool headless = false;
+    bool benchmark = false;
+    bool customSize = false;
+    int frames = 0; // 0 for the default
+    int warmup = 30;
+    std::string output = platformPath("frames/");
+    std::string format = "png"; // Or exr
+    std::string cameraPath;
+    std::string json = platformPath("benchmark.json");
+    std::string record;
+    std::string replay;
+    std::string trace;
+};
+Options options;
+
+std::unique_ptr<EventRecorder> recorder;
+EventPlayer player;
+bool replaying = false;
+
+#ifdef HEADLESS_EGL
+std::unique_ptr<EglContext> eglContext;
+#endif
+
 std::vector<Event> queue;
 
 struct EventValue {
@@ -45,11 +94,62 @@ std::map<int, EventValue> keyMap = {
     { GLFW_KEY_R, {Event::RESET_TEST_CAM } },
 };
 
+void parseArguments(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            options.headless = true;
+        } else if (std::strcmp(argv[i], "--benchmark") == 0) {
+            options.headless = options.benchmark = true;
+        } else if (std::strcmp(argv[i], "--path") == 0 && hasValue) {
+            options.cameraPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) {
+            options.warmup = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--json") == 0 && hasValue) {
+            options.json = argv[++i];
+        } else if (std::strcmp(argv[i], "--format") == 0 && hasValue) {
+            options.format = argv[++i];
+        } else if (std::strcmp(argv[i], "--record") == 0 && hasValue) {
+            options.record = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay") == 0 && hasValue) {
+            options.replay = argv[++i];
+        } else if (std::strcmp(argv[i], "--trace") == 0 && hasValue) {
+            options.trace = argv[++i];
+#ifndef CPU_PROFILER
+            std::cout << "--trace needs a build with CPU_PROFILER, no trace is written\n";
+#endif
+        } else if (std::strcmp(argv[i], "--size") == 0 && hasValue) {
+            options.customSize = std::sscanf(argv[++i], "%dx%d", &width, &height) == 2;
+        } else if (std::strcmp(argv[i], "--frames") == 0 && hasValue) {
+            options.frames = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--output") == 0 && hasValue) {
+            options.output = argv[++i];
+            if (options.output.back() != '/') { options.output += '/'; }
+        } else {
+            std::cout << "Unknown argument " << argv[i] << "\n";
+        }
+    }
+}
+
 void init() {
+#ifdef HEADLESS_EGL
+    if (options.headless) {
+        eglContext.reset(new EglContext());
+        if (!eglContext->isValid() || !gladLoadGLLoader(EglContext::getProcAddress)) {
+            std::cout << "Error creating the headless context!\n";
+            exit(-1);
+        }
+        loadGLExtensions(EglContext::getProcAddress);
+        return;
+    }
+#endif
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_STENCIL_BITS, 8); // The fused post draws the DOF tiles to the screen
+    // Without EGL the headless mode still needs a display, the window just isn't shown
+    glfwWindowHint(GLFW_VISIBLE, options.headless ? GLFW_FALSE : GLFW_TRUE);
 
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -68,12 +168,18 @@ void init() {
     glfwSetFramebufferSizeCallback(window, resizeCallback);
     glfwSetCursorPosCallback(window, mouseCallback);
     glfwSetScrollCallback(window, scrollCallback);
-    glfwSwapInterval(1);
+    glfwSwapInterval(options.headless ? 0 : 1);
 
     if (!gladLoadGL()) {
         std::cout << "Error loading glad!\n";
         return;
     }
+    loadGLExtensions(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+    if (options.headless) { return; }
+
+    int framebufferWidth, framebufferHeight; // Differs from the window size on high dpi screens
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    FrameBufferObject::setScreenViewport(framebufferWidth, framebufferHeight);
 
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -82,11 +188,122 @@ void init() {
     ImGui_ImplOpenGL3_Init("#version 330 core");
 }
 
-int main() {
+/**
+ * Renders a fixed number of frames into an FBO with a fixed time step, so every run gives the same images
+ */
+void runHeadless() {
+    OffscreenTarget target(width, height);
+    makeDirectory(options.output);
+    const int frames = options.frames > 0 ? options.frames : (replaying ? player.getFrameCount() : 1);
+    std::cout << "Rendering " << frames << " frames at " << width << "x" << height
+        << " to " << options.output << "\n";
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < frames; i++) {
+        PROFILE_SCOPE("Frame");
+        getFramePacer().beginFrame();
+        target.bind();
+        glClearColor(scene->background.r, scene->background.g, scene->background.b, scene->background.a);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        getShaderReloader().update();
+        getGpuProfiler().beginFrame();
+        scene->draw();
+        getGpuProfiler().endFrame();
+        float step = 1.f / 60.f;
+        if (replaying) { player.next(queue, step); }
+        scene->update(queue, step);
+        queue.clear();
+
+        // Read back in the background, the encoding doesn't hold up the next frames
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%04d.", i);
+        getFrameCapture().captureFramebuffer(target.getId(), width, height, options.output + name + options.format);
+        getFrameCapture().update();
+        getFramePacer().endFrame();
+    }
+    getFrameCapture().finish();
+    std::cout << "Done in " << std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count()
+        << " s\n";
+}
+
+/**
+ * Same fixed time step as runHeadless(), but the camera follows the path and nothing is read back
+ * The warmup frames stay at the start of the path, they give the driver and caches time to settle
+ */
+void runBenchmark() {
+    CameraPath path = CameraPath::getDefault();
+    if (!options.cameraPath.empty() && !path.load(options.cameraPath)) { return; }
+    const float step = 1.f / 60.f;
+    int frames = options.frames > 0 ? options.frames : int(path.getDuration() / step) + 1;
+    if (replaying && options.frames <= 0) { frames = player.getFrameCount(); }
+
+    OffscreenTarget target(width, height);
+    Benchmark benchmark;
+    getGpuProfiler().enabled = true;
+    std::cout << "Benchmarking " << frames << " frames at " << width << "x" << height << "\n";
+
+    for (int i = -options.warmup; i < frames; i++) {
+        if (i == 0) { benchmark.reset(); }
+        PROFILE_SCOPE("Frame");
+        benchmark.beginFrame();
+        getFramePacer().beginFrame(); // Its wait counts into the frame time like in the window
+        if (!replaying) {
+            path.apply(getDefaultCam(), float(std::max(i, 0)) * step);
+        }
+        target.bind();
+        glClearColor(scene->background.r, scene->background.g, scene->background.b, scene->background.a);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        getGpuProfiler().beginFrame();
+        scene->draw();
+        getGpuProfiler().endFrame();
+        float frameStep = step;
+        if (replaying && i >= 0) { player.next(queue, frameStep); }
+        scene->update(queue, frameStep);
+        queue.clear();
+        getFramePacer().endFrame();
+        benchmark.endFrame();
+    }
+
+    benchmark.print();
+    const std::map<std::string, std::string> settings = {
+        { "width", std::to_string(width) },
+        { "height", std::to_string(height) },
+        { "warmup", std::to_string(options.warmup) },
+        { "timeStep", std::to_string(step) },
+        { "path", "\"" + (replaying ? options.replay :
+            options.cameraPath.empty() ? std::string("default") : options.cameraPath) + "\"" },
+        { "renderer", "\"" + std::string(reinterpret_cast<const char*>(glGetString(GL_RENDERER))) + "\"" },
+    };
+    if (benchmark.writeJson(options.json, settings)) {
+        std::cout << "Wrote " << options.json << "\n";
+    }
+}
+
+/**
+ * Writes the CPU trace asked for with --trace, once nothing is rendered anymore
+ */
+void exportTrace() {
+#ifdef CPU_PROFILER
+    if (!options.trace.empty() && getCpuProfiler().exportChromeTrace(options.trace)) {
+        std::cout << "Wrote " << options.trace << "\n";
+    }
+#endif
+}
+
+int main(int argc, char** argv) {
+    parseArguments(argc, argv);
+    if (!options.replay.empty()) {
+        if (!player.load(options.replay)) { return -1; }
+        replaying = true;
+        if (!options.customSize) {
+            width = player.getWidth();
+            height = player.getHeight();
+        }
+        std::cout << "Replaying " << player.getFrameCount() << " frames from " << options.replay << "\n";
+    }
     init();
-    
-    ImGuiIO& io = ImGui::GetIO();
-    io.IniFilename = nullptr;
 
     scene = new DemoScene(width, height);
     
@@ -96,20 +313,54 @@ int main() {
     GLC(glEnable(GL_CULL_FACE));
     //GLC(glEnable(GL_BLEND));
     //GLC(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+
+    if (options.headless) {
+        if (options.benchmark) {
+            runBenchmark();
+        } else {
+            runHeadless();
+        }
+        exportTrace();
+        delete scene; // Still needs the context
+#ifdef HEADLESS_EGL
+        eglContext.reset();
+#else
+        glfwDestroyWindow(window);
+        glfwTerminate();
+#endif
+        return 0;
+    }
+
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+
+    if (!options.record.empty()) {
+        recorder.reset(new EventRecorder(options.record, width, height));
+    }
     
     while (!glfwWindowShouldClose(window)) {
+        PROFILE_SCOPE("Frame");
+        getFramePacer().beginFrame(); // Might wait for the GPU, so it comes before the input
         float currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
         
-        glClearColor(0.9f, 0.9f, 1.f, 1.0f);
+        if (scene != nullptr) {
+            glClearColor(scene->background.r, scene->background.g, scene->background.b, scene->background.a);
+        }
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        getShaderReloader().update();
+        getFrameCapture().update();
+        getGpuProfiler().beginFrame();
         if (scene != nullptr) {
             scene->draw();
         }
 
-        glfwPollEvents();
+        {
+            PROFILE_SCOPE("glfwPollEvents");
+            glfwPollEvents();
+        }
         if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
             glfwSetWindowShouldClose(window, true);
         }
@@ -132,6 +383,19 @@ int main() {
                     }
                 }
             }
+            if (replaying) {
+                // The live input is ignored, except the window still resizing
+                queue.erase(std::remove_if(queue.begin(), queue.end(), [](const Event& e) {
+                    return e.type != Event::RESIZE;
+                }), queue.end());
+                if (!player.next(queue, deltaTime)) {
+                    std::cout << "Replay finished\n";
+                    replaying = false;
+                }
+            }
+            if (recorder != nullptr) {
+                recorder->record(queue, deltaTime);
+            }
             scene->update(queue, deltaTime);
             queue.clear();
         }
@@ -140,11 +404,19 @@ int main() {
         ImGui::Render();
         int display_w, display_h;
         glfwGetFramebufferSize(window, &display_w, &display_h);
+        getGpuProfiler().mark("ImGui");
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        getGpuProfiler().endFrame();
 
-        glfwSwapBuffers(window);
+        {
+            PROFILE_SCOPE("glfwSwapBuffers"); // Waits for vsync
+            glfwSwapBuffers(window);
+        }
+        getFramePacer().endFrame();
     }
 
+    getFrameCapture().finish();
+    exportTrace();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -159,7 +431,7 @@ int main() {
 void resizeCallback(GLFWwindow* window, int w, int h) {
     width = w;
     height = h;
-    GLC(glViewport(0, 0, width, height));
+    FrameBufferObject::setScreenViewport(width, height);
     queue.push_back({ Event::RESIZE, float(width), float(height) });
 }
 
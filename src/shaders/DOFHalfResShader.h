@@ -0,0 +1,86 @@
+#pragma once
+#include "../wrapper/Shader.h"
+#include "DOFTileShader.h"
+#include "PostShader.h"
+
+/**
+ * Halves the resolution of the shaded image and the linear distance for the DOF
+ * The colors are weighted by their coc, so sharp pixels don't bleed into the blur,
+ * the distance keeps the closest one so the foreground survives
+ * Writes into targets named like the full resolution ones, so the DOF shaders don't change
+ */
+inline Shader& getDofDownsampleShader() {
+    static Shader shader = { Shader::getBillboardVertexShader(), Shader::include(GLSL(
+        layout (location = 0) out vec3 shadedPass;
+        layout (location = 1) out float linearDistance;
+
+        uniform sampler2D fullColor;
+        uniform sampler2D fullDistance;
+
+        void main() {
+            ivec2 size = textureSize(fullColor, 0);
+            ivec2 base = ivec2(gl_FragCoord.xy) * 2;
+            vec3 color = vec3(0.0);
+            float weights = 0.0;
+            float closest = 1e20;
+            for (int i = 0; i < 4; i++) {
+                ivec2 texel = min(base + ivec2(i & 1, i >> 1), size - 1);
+                float depth = texelFetch(fullDistance, texel, 0).r;
+                float w = getCoc(depth) + 0.001; // Premultiplied by the coc
+                color += texelFetch(fullColor, texel, 0).rgb * w;
+                weights += w;
+                closest = min(closest, depth);
+            }
+            shadedPass = color / weights;
+            linearDistance = closest;
+        }
+    ), getDofCoc()), __FILE__, "downsample" };
+    return shader;
+}
+
+/**
+ * Upsamples the half resolution DOF and blends it with the sharp image by the coc
+ * The upsampling weighs the closest texels by their distance, so the blur of the
+ * background doesn't spill over sharp edges
+ * FUSED_POST ends it with the post effects
+ */
+inline ShaderPermutations& getDofCompositeShader() {
+    static ShaderPermutations shader = { Shader::getBillboardVertexShader(), Shader::include(GLSL(
+        out vec3 FragColor;
+        in vec2 TexCoords;
+
+        uniform sampler2D fullColor;
+        uniform sampler2D fullDistance;
+        uniform sampler2D halfDof;
+        uniform sampler2D halfDistance;
+
+        vec3 upsampledDof(float depth) {
+            ivec2 size = textureSize(halfDof, 0);
+            vec2 pos = TexCoords * vec2(size) - 0.5;
+            vec2 f = fract(pos);
+            ivec2 base = ivec2(floor(pos));
+            vec3 result = vec3(0.0);
+            float weights = 0.0;
+            for (int i = 0; i < 4; i++) {
+                ivec2 o = ivec2(i & 1, i >> 1);
+                ivec2 texel = clamp(base + o, ivec2(0), size - 1);
+                float bilinear = (o.x == 1 ? f.x : 1.0 - f.x) * (o.y == 1 ? f.y : 1.0 - f.y);
+                float range = abs(texelFetch(halfDistance, texel, 0).r - depth) / depth;
+                float w = bilinear / (0.001 + range);
+                result += texelFetch(halfDof, texel, 0).rgb * w;
+                weights += w;
+            }
+            return result / max(weights, 0.0001);
+        }
+
+        void main() {
+            vec3 sharp = texture(fullColor, TexCoords).rgb;
+            float depth = texture(fullDistance, TexCoords).r;
+            // Below a pixel the sharp image is better than anything from half resolution
+            float blend = smoothstep(0.5, 2.0, getCoc(depth));
+            vec3 color = blend > 0.0 ? mix(sharp, upsampledDof(depth), blend) : sharp;
+            FragColor = FUSED_POST ? applyPost(color, TexCoords) : color;
+        }
+    ), getDofCoc() + getPostChunk()), withPostDefines({}), __FILE__ };
+    return shader;
+}
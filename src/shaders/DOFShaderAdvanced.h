@@ -1,5 +1,6 @@
 #pragma once
-#include "../wrapper/Shader.h"
+#include "../wrapper/ShaderPermutations.h"
+#include "PostShader.h"
 
 
 /**
@@ -8,9 +9,10 @@
  * It's gathering surrounding samples in a spiral pattern
  * and performs blending based on the coc of these samples
  * which results in a smooth falloff
+ * ITERATIONS and BLADES can be fixed per variant
  */
-inline Shader& getDOFShaderAdvanced() {
-    static Shader shader = { Shader::getBillboardVertexShader(), GLSL(
+inline ShaderPermutations& getDOFShaderAdvanced() {
+    static ShaderPermutations shader = { Shader::getBillboardVertexShader(), Shader::include(GLSL(
         out vec3 FragColor;
         in vec2 TexCoords;
 
@@ -48,9 +50,9 @@ inline Shader& getDOFShaderAdvanced() {
             float steps = 1.0;
             
             // Smaller = nicer blur, larger = faster. Will roughly reach the max blur size with the samples given
-            float RAD_SCALE = 12.5 / (float(iterations) + 11.0) * MAX_BLUR_SIZE; 
+            float RAD_SCALE = 12.5 / (float(ITERATIONS) + 11.0) * MAX_BLUR_SIZE; 
             float radius = RAD_SCALE;
-            float n = apertureBlades;
+            float n = float(BLADES);
             for (float ang = 0.0; radius < MAX_BLUR_SIZE; ang += GOLDEN_ANGLE) {
                 float r = radius * cos(PI / n);
                 r /= cos(ang - (2.0f * PI / n) * floor((n * ang + PI) / 2.0f / PI));
@@ -70,9 +72,9 @@ inline Shader& getDOFShaderAdvanced() {
                 radius += RAD_SCALE / radius;
             }
             color /= steps;
-            FragColor = color;
+            FragColor = FUSED_POST ? applyPost(color, TexCoords) : color;
         }
-    ), __FILE__ };
+    ), getPostChunk()), withPostDefines({ { "ITERATIONS", "iterations" }, { "BLADES", "apertureBlades" } }), __FILE__ };
     return shader;
 }
 
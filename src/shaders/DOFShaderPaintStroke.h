@@ -55,6 +55,6 @@ inline Shader &getDofShaderPaintStroke() {
             // color /= float(iterations);
             FragColor = color;
         }
-    ), __FILE__ };
+    ), __FILE__, "paintStroke" };
     return shader;
 }
\ No newline at end of file
@@ -1,8 +1,68 @@
 #pragma once
-#include "../wrapper/Shader.h"
-
-inline Shader& getDofShaderShape() {
-    static Shader shader = { Shader::getBillboardVertexShader() , GLSL(
+#include "../wrapper/ShaderPermutations.h"
+#include "PostShader.h"
+#include <vector>
+#include <cmath>
+
+/**
+ * Samples per kernel in the uniform block, enough for 512 iterations
+ * The block holds two kernels, so the cheap and full tile classes don't overwrite each other
+ */
+const int BOKEH_KERNEL_SAMPLES = 576;
+const GLuint BOKEH_KERNEL_BINDING = 1;
+
+/**
+ * Projects coordinates on a unit square from -1.0 to 1.0 onto a polygon
+ * Port of the concentric mapping from
+ * http://www.adriancourreges.com/blog/2018/12/02/ue4-optimized-post-effects/
+ * Based on Shirley’s concentric mapping
+ */
+inline glm::vec2 squareToPolygonMapping(float a, float b, float edgeCount) {
+    const float PI = 3.1415926f;
+    const float EPSILON = 0.000001f;
+    float radius, angle;
+    if (std::abs(a) > std::abs(b)) { // First region (left and right quadrants of the disk)
+        radius = a;
+        angle = b / (a + EPSILON) * PI / 4.f;
+    } else { // Second region (top and botom quadrants of the disk)
+        radius = b;
+        angle = PI / 2.f - (a / (b + EPSILON) * PI / 4.f);
+    }
+    if (radius < 0.f) { // Always keep radius positive
+        radius *= -1.f;
+        angle += PI;
+    }
+    // Re-scale radius to match a polygon shape
+    radius *= std::cos(PI / edgeCount) /
+        std::cos(angle - (2.f * PI / edgeCount) * std::floor((edgeCount * angle + PI) / 2.f / PI));
+    return { radius * std::cos(angle), radius * std::sin(angle) };
+}
+
+/**
+ * The sample offsets of the shaped DOF, they only depend on the iterations and aperture blades
+ * so they are computed once and uploaded. Tightly packed two per vec4 in the uniform block
+ */
+inline std::vector<glm::vec2> getBokehKernel(int iterations, int apertureBlades) {
+    std::vector<glm::vec2> kernel;
+    if (iterations <= 0) { return kernel; }
+    const int iterationsX = int(std::floor(std::sqrt(float(iterations))));
+    const float stepSize = 2.0f / float(iterationsX);
+    // Same float stepping as the loop this replaces, so the sample count doesn't change
+    for (float x = -1.0f; x <= 1.0f; x += stepSize) {
+        for (float y = -1.0f; y <= 1.0f; y += stepSize) {
+            if (kernel.size() == BOKEH_KERNEL_SAMPLES) { return kernel; }
+            kernel.push_back(squareToPolygonMapping(x, y, float(apertureBlades)));
+        }
+    }
+    return kernel;
+}
+
+/**
+ * DOF gathering the precomputed bokeh kernel, KERNEL_SIZE can be fixed per variant
+ * FUSED_POST ends it with the post effects
+ */
+inline ShaderPermutations& getDofShaderShape() {
+    static ShaderPermutations shader = { Shader::getBillboardVertexShader() , Shader::include(GLSL(
         out vec3 FragColor;
         in vec2 TexCoords;
 
@@ -13,57 +73,12 @@ inline Shader& getDofShaderShape() {
         uniform float focus;
         uniform float aperture;
         uniform float focalLength;
-        uniform int apertureBlades;
         uniform float bokehSqueeze;
         uniform float bokehSqueezeFalloff;
         uniform float aspectRatio = 1.777;
-        uniform int iterations = 64;
 
-        const float PI = 3.1415926f;
-        const float PI_OVER_2 = 1.5707963f;
-        const float PI_OVER_4 = 0.785398f;
-        const float EPSILON = 0.000001f;
-
-        /**
-         * Projects coordinates on a unit square from -1.0 to 1.0 onto a circle
-         * Ported GLSL version of
-         * http://www.adriancourreges.com/blog/2018/12/02/ue4-optimized-post-effects/
-         * Based on Shirley’s concentric mapping
-         */
-        vec2 UnitSquareToUnitDiskPolar(float a, float b) {
-            float radius;
-            float angle;
-            if (abs(a) > abs(b)) { // First region (left and right quadrants of the disk)
-                radius = a;
-                angle = b / (a + EPSILON) * PI_OVER_4;
-            } else { // Second region (top and botom quadrants of the disk)
-                radius = b;
-                angle = PI_OVER_2 - (a / (b + EPSILON) * PI_OVER_4);
-            }
-            if (radius < 0) { // Always keep radius positive
-                radius *= -1.0f;
-                angle += PI;
-            }
-            return vec2(radius, angle);
-        }
-
-        vec2 SquareToDiskMapping(float a, float b) {
-            vec2 PolarCoord = UnitSquareToUnitDiskPolar(a, b);
-            return vec2(PolarCoord.x * cos(PolarCoord.y), PolarCoord.x * sin(PolarCoord.y));
-        }
-
-        vec2 SquareToPolygonMapping(float a, float b, float edgeCount, float shapeRotation) {
-            vec2 PolarCoord = UnitSquareToUnitDiskPolar(a, b); // (radius, angle)
-
-            // Re-scale radius to match a polygon shape
-            PolarCoord.x *= cos(PI / edgeCount) /
-                cos(PolarCoord.y - (2.0f * PI / edgeCount) * floor((edgeCount * PolarCoord.y + PI) / 2.0f / PI));
-
-            // Apply a rotation to the polygon shape
-            PolarCoord.y += shapeRotation;
-
-            return vec2(PolarCoord.x * cos(PolarCoord.y), PolarCoord.x * sin(PolarCoord.y));
-        }
+        uniform int kernelOffset = 0; // Which of the kernels in the block
+        uniform int kernelSize = 0;
 
         /**
          * 2D Rotation matrix from a radian angle
@@ -88,8 +103,8 @@ inline Shader& getDofShaderShape() {
             
             vec3 color = texture(shadedPass, uv).rgb;
             
-            if (iterations == 0) {
-                FragColor = color;
+            if (KERNEL_SIZE == 0) {
+                FragColor = FUSED_POST ? applyPost(color, TexCoords) : color;
                 return;
             }
 
@@ -126,44 +141,39 @@ inline Shader& getDofShaderShape() {
             float centerDepth = texture(linearDistance, TexCoords).r;
             float centerBlur = getBlurSize(centerDepth);
 
-            /**
-             * Handle the iterations 
-             */
-            int iterationsX = int(floor(sqrt(float(iterations))));
-            float stepSize = 2.0f / float(iterationsX);
+            squeeze *= (focalLength / aperture) * 50.0;
             float steps = 1.0;
 
-            for (float x = -1.0; x <= 1.0; x += stepSize) {
-                for (float y = -1.0; y <= 1.0; y += stepSize) {
-                    /**
-                     * This is the offset we'll use to get the depth and color
-                     * It's already in the bokeh shape and squeezed
-                     */
-                    vec2 offset = SquareToPolygonMapping(x, y, float(apertureBlades), 0.0);
-                    offset *= (focalLength / aperture) * 50.0;
-                    offset *= squeeze;
+            /**
+             * The kernel is already in the bokeh shape, only the squeeze depends on the pixel
+             */
+            for (int i = kernelOffset; i < kernelOffset + KERNEL_SIZE; i++) {
+                vec4 pair = bokehKernel[i >> 1];
+                vec2 offset = ((i & 1) == 0 ? pair.xy : pair.zw) * squeeze; // Row vector, like the per pixel mapping did
 
-                    float sampleDepth = texture(linearDistance, uv + offset).r;
-                    float sampleBlur = getBlurSize(sampleDepth);
+                float sampleDepth = texture(linearDistance, uv + offset).r;
+                float sampleBlur = getBlurSize(sampleDepth);
 
-                    if (sampleDepth > centerDepth) {
-                        sampleBlur = clamp(sampleBlur, 0.0, centerBlur * 2.0);
-                    }
+                if (sampleDepth > centerDepth) {
+                    sampleBlur = clamp(sampleBlur, 0.0, centerBlur * 2.0);
+                }
 
-                    sampleBlur = clamp(sampleBlur, 0.0, 1.0);
+                sampleBlur = clamp(sampleBlur, 0.0, 1.0);
 
-                    /**
-                     * Based on that we'll move the sample point closer to the center.
-                     */
-                    vec3 sampleColor = texture(shadedPass, uv + offset * sampleBlur).rgb;
+                /**
+                 * Based on that we'll move the sample point closer to the center.
+                 */
+                vec3 sampleColor = texture(shadedPass, uv + offset * sampleBlur).rgb;
 
-                    color += sampleColor;
-                    steps += 1.0;
-                }
+                color += sampleColor;
+                steps += 1.0;
             }
             color /= steps;
-            FragColor = color;
+            FragColor = FUSED_POST ? applyPost(color, TexCoords) : color;
         }
-    ), __FILE__ };
+    ), "layout (std140) uniform BokehKernel { vec4 bokehKernel[" + std::to_string(BOKEH_KERNEL_SAMPLES) + "]; };\n" + getPostChunk()),
+        withPostDefines({ { "KERNEL_SIZE", "kernelSize" } }), __FILE__,
+        [](const Shader& variant) { variant.bindUniformBlock("BokehKernel", BOKEH_KERNEL_BINDING); }
+    };
     return shader;
 }
\ No newline at end of file
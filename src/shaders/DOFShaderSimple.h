@@ -1,13 +1,15 @@
 #pragma once
-#include "../wrapper/Shader.h"
+#include "../wrapper/ShaderPermutations.h"
+#include "PostShader.h"
 
 
 /**
  * Simple DOF
  * Blurs the image with a blur size directly based of its own circle of confusion
+ * ITERATIONS can be fixed per variant, FUSED_POST ends it with the post effects
  */
-inline Shader &getDofShaderSimple() {
-    static Shader shader = { Shader::getBillboardVertexShader() , GLSL(
+inline ShaderPermutations& getDofShaderSimple() {
+    static ShaderPermutations shader = { Shader::getBillboardVertexShader() , Shader::include(GLSL(
         out vec3 FragColor;
         in vec2 TexCoords;
 
@@ -23,6 +25,7 @@ inline Shader &getDofShaderSimple() {
         uniform float bokehSqueeze;
         uniform float bokehSqueezeFalloff;
         uniform float aspectRatio = 1.777;
+        uniform float frameOffset = 0.0; // Changes the noise for temporal accumulation
 
         const float MAX_BLUR_SIZE = 20.0;
 
@@ -45,15 +48,15 @@ inline Shader &getDofShaderSimple() {
             float centerDepth = texture(linearDistance, TexCoords).r;
             float centerBlur = getBlurSize(centerDepth);
             vec3 color = texture(shadedPass, TexCoords).rgb;
-            for (int i = 0; i < iterations; i++) {
-                vec2 offset = rand2(TexCoords + i) * centerBlur;
+            for (int i = 0; i < ITERATIONS; i++) {
+                vec2 offset = rand2(TexCoords + float(i) + frameOffset) * centerBlur;
                 vec2 uv = TexCoords + offset * pixelSize;
                 color += texture(shadedPass, uv).rgb;
             }
-            color /= float(iterations);
-            FragColor = color;
+            color /= float(ITERATIONS);
+            FragColor = FUSED_POST ? applyPost(color, TexCoords) : color;
             // FragColor = vec3(centerBlur);
         }
-    ), __FILE__ };
+    ), getPostChunk()), withPostDefines({ { "ITERATIONS", "iterations" } }), __FILE__ };
     return shader;
 }
\ No newline at end of file
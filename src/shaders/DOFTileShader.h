@@ -0,0 +1,116 @@
+#pragma once
+#include "../wrapper/ShaderPermutations.h"
+#include "PostShader.h"
+
+/**
+ * Size of the tiles the DOF gets classified in
+ */
+const int DOF_TILE_SIZE = 16;
+
+/**
+ * Circle of confusion in pixels, the same formula as the DOF shaders use
+ * cocScale and maxCoc adapt it to how far the current DOF shader really samples
+ */
+inline std::string getDofCoc() {
+    return GLSL_CHUNK(
+        uniform float focus;
+        uniform float aperture;
+        uniform float focalLength;
+        uniform float cocScale = 10000.0;
+        uniform float maxCoc = 20.0;
+
+        float getCoc(float depth) {
+            return min(abs(
+                (focalLength * (focus - depth)) /
+                (depth * (focus - focalLength))
+            ) * (focalLength / aperture) * cocScale, maxCoc);
+        }
+    );
+}
+
+/**
+ * Min and max circle of confusion in pixels for every tile
+ */
+inline Shader& getDofTileShader() {
+    static Shader shader = { Shader::getBillboardVertexShader(), Shader::include(GLSL(
+        layout (location = 0) out vec2 tileCoc;
+
+        uniform sampler2D linearDistance;
+        uniform int tileSize = 16;
+
+        void main() {
+            ivec2 size = textureSize(linearDistance, 0);
+            ivec2 start = ivec2(gl_FragCoord.xy) * tileSize;
+            ivec2 end = min(start + tileSize, size);
+            float low = maxCoc;
+            float high = 0.0;
+            for (int y = start.y; y < end.y; y++) {
+                for (int x = start.x; x < end.x; x++) {
+                    float coc = getCoc(texelFetch(linearDistance, ivec2(x, y), 0).r);
+                    low = min(low, coc);
+                    high = max(high, coc);
+                }
+            }
+            tileCoc = vec2(low, high);
+        }
+    ), getDofCoc()), __FILE__, "tile" };
+    return shader;
+}
+
+/**
+ * Spreads the max coc to the neighbouring tiles, since blurry pixels gather from
+ * or bleed over into pixels of the tiles around them
+ */
+inline Shader& getDofTileDilateShader() {
+    static Shader shader = { Shader::getBillboardVertexShader(), GLSL(
+        layout (location = 0) out vec2 dilatedCoc;
+
+        uniform sampler2D tileCoc;
+        uniform int dilation = 1; // In tiles
+
+        void main() {
+            ivec2 size = textureSize(tileCoc, 0);
+            ivec2 tile = ivec2(gl_FragCoord.xy);
+            vec2 result = texelFetch(tileCoc, tile, 0).rg;
+            for (int y = -dilation; y <= dilation; y++) {
+                for (int x = -dilation; x <= dilation; x++) {
+                    vec2 coc = texelFetch(tileCoc, clamp(tile + ivec2(x, y), ivec2(0), size - 1), 0).rg;
+                    result = vec2(min(result.x, coc.x), max(result.y, coc.y));
+                }
+            }
+            dilatedCoc = result;
+        }
+    ), __FILE__, "dilate" };
+    return shader;
+}
+
+/**
+ * Sorts the pixels into the classes of their tile:
+ * 0 in focus and only copied, 1 small coc with a cheap kernel, 2 the full DOF
+ * Discards everything below minClass, so it's used to mark the stencil buffer
+ * With minClass 0 it copies the image, which is all the in focus class needs,
+ * FUSED_POST applies the post effects to the copy
+ */
+inline ShaderPermutations& getDofClassifyShader() {
+    static ShaderPermutations shader = { Shader::getBillboardVertexShader(), Shader::include(GLSL(
+        out vec3 FragColor;
+        in vec2 TexCoords;
+
+        uniform sampler2D shadedPass;
+        uniform sampler2D dilatedCoc;
+        uniform int tileSize = 16;
+        uniform int minClass = 0;
+        uniform float smallCoc = 4.0; // Up to here the cheap kernel is good enough
+
+        void main() {
+            float maxCoc = texelFetch(dilatedCoc, ivec2(gl_FragCoord.xy) / tileSize, 0).g;
+            int tileClass = maxCoc < 0.5 ? 0 : (maxCoc < smallCoc ? 1 : 2);
+            if (tileClass < minClass) {
+                discard;
+            }
+            vec3 color = texture(shadedPass, TexCoords).rgb;
+            FragColor = FUSED_POST ? applyPost(color, TexCoords) : color;
+        }
+    ), getPostChunk()), withPostDefines({}), __FILE__ };
+    return shader;
+}
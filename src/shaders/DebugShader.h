@@ -21,6 +21,6 @@ inline Shader& getDebugShader() {
             }
             FragColor.rgb *= scale;
         }
-    ), __FILE__ };
+    ), __FILE__, "debug" };
     return shader;
 }
\ No newline at end of file
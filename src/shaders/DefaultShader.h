@@ -30,6 +30,6 @@ inline Shader& getDefaultShader() {
         void main() {
             FragColor = texture(texture_diffuse1, TexCoords);
         }
-    ), __FILE__ };
+    ), __FILE__, "default" };
     return shader;
 }
\ No newline at end of file
@@ -1,43 +1,50 @@
 #pragma once
 
 #include "../wrapper/Shader.h"
+#include "GBufferLayout.h"
+#include <map>
 
 /**
- * Simple deferred shader which only filters and applies the SSAO and does FXAA
+ * Simple deferred shader which only upsamples and applies the SSAO and does FXAA
  */
-inline Shader& getDeferredShader() {
-    static Shader shader = { Shader::getBillboardVertexShader(), GLSL(
+inline Shader& getDeferredShader(const GBufferLayout& layout = {}) {
+    static std::map<int, std::unique_ptr<Shader>> variants;
+    std::unique_ptr<Shader>& shader = variants[layout.key()];
+    if (shader != nullptr) { return *shader; }
+    shader.reset(new Shader(Shader::getBillboardVertexShader(), Shader::include(GLSL(
         layout(location = 0) out vec4 shadedPass;
         layout(location = 1) out float linearDistance;
 
         in vec2 TexCoords;
-        uniform sampler2D gPosition;
-        uniform sampler2D gNormal;
-        uniform sampler2D gColor;
-        uniform sampler2D ssaoPass; // The unblurred SSAO
+        uniform sampler2D ssaoPass; // The blurred SSAO at its own resolution
+        uniform sampler2D ssaoDepth; // The linear depth the SSAO was computed with
 
         uniform float zNear;
         uniform float zFar;
-        uniform int blur = 4;
+        uniform bool bilateral = true;
 
         /**
-         * Based on
-         * https://learnopengl.com/code_viewer_gh.php?code=src/5.advanced_lighting/9.ssao/9.ssao_blur.fs
+         * Joint bilateral upsampling
+         * Weighs the four closest SSAO texels by how close their depth is to the depth
+         * of this pixel, so the low resolution AO doesn't bleed over edges
          */
-        float blurredSSAO(float depth) {
-            if (blur == 0) { // Skip the whole thing and return the unblurred ssao
-                return texture(ssaoPass, TexCoords).r;
-            }
-            vec2 texelSize = 1.0 / vec2(textureSize(ssaoPass, 0));
+        float upsampledSSAO(float depth) {
+            ivec2 size = textureSize(ssaoPass, 0);
+            vec2 pos = TexCoords * vec2(size) - 0.5;
+            vec2 f = fract(pos);
+            ivec2 base = ivec2(floor(pos));
             float result = 0.0;
-            for (int x = -blur; x < blur; ++x) {
-                for (int y = -blur; y < blur; ++y) {
-                    vec2 offset = vec2(float(x), float(y)) * texelSize;
-                    result += texture(ssaoPass, TexCoords + offset).r;
-                }
+            float weights = 0.0;
+            for (int i = 0; i < 4; i++) {
+                ivec2 o = ivec2(i & 1, i >> 1);
+                ivec2 texel = clamp(base + o, ivec2(0), size - 1);
+                float bilinear = (o.x == 1 ? f.x : 1.0 - f.x) * (o.y == 1 ? f.y : 1.0 - f.y);
+                float range = abs(texelFetch(ssaoDepth, texel, 0).r - depth) / depth;
+                float w = bilinear / (0.001 + range);
+                result += texelFetch(ssaoPass, texel, 0).r * w;
+                weights += w;
             }
-            int d = blur * 2;
-            return result / (d * d);
+            return result / max(weights, 0.0001);
         }
 
         void main() {
@@ -50,13 +57,13 @@ inline Shader& getDeferredShader() {
             const float FXAA_REDUCE_MUL = 1.0/8.0;
             const float FXAA_REDUCE_MIN = 1.0/128.0;
 
-            vec2 frameBufSize = vec2(textureSize(gColor, 0));
+            vec2 frameBufSize = gBufferSize();
 
-            vec3 rgbNW=texture2D(gColor,TexCoords+(vec2(-1.0,-1.0)/frameBufSize)).xyz;
-            vec3 rgbNE=texture2D(gColor,TexCoords+(vec2(1.0,-1.0)/frameBufSize)).xyz;
-            vec3 rgbSW=texture2D(gColor,TexCoords+(vec2(-1.0,1.0)/frameBufSize)).xyz;
-            vec3 rgbSE=texture2D(gColor,TexCoords+(vec2(1.0,1.0)/frameBufSize)).xyz;
-            vec3 rgbM=texture2D(gColor,TexCoords).xyz;
+            vec3 rgbNW=readColor(TexCoords+(vec2(-1.0,-1.0)/frameBufSize)).xyz;
+            vec3 rgbNE=readColor(TexCoords+(vec2(1.0,-1.0)/frameBufSize)).xyz;
+            vec3 rgbSW=readColor(TexCoords+(vec2(-1.0,1.0)/frameBufSize)).xyz;
+            vec3 rgbSE=readColor(TexCoords+(vec2(1.0,1.0)/frameBufSize)).xyz;
+            vec3 rgbM=readColor(TexCoords).xyz;
 
             vec3 luma=vec3(0.299, 0.587, 0.114);
             float lumaNW = dot(rgbNW, luma);
@@ -83,11 +90,11 @@ inline Shader& getDeferredShader() {
                 dir * rcpDirMin)) / frameBufSize;
 
             vec3 rgbA = (1.0/2.0) * (
-                texture2D(gColor, TexCoords.xy + dir * (1.0/3.0 - 0.5)).xyz +
-                texture2D(gColor, TexCoords.xy + dir * (2.0/3.0 - 0.5)).xyz);
+                readColor(TexCoords.xy + dir * (1.0/3.0 - 0.5)).xyz +
+                readColor(TexCoords.xy + dir * (2.0/3.0 - 0.5)).xyz);
             vec3 rgbB = rgbA * (1.0/2.0) + (1.0/4.0) * (
-                texture2D(gColor, TexCoords.xy + dir * (0.0/3.0 - 0.5)).xyz +
-                texture2D(gColor, TexCoords.xy + dir * (3.0/3.0 - 0.5)).xyz);
+                readColor(TexCoords.xy + dir * (0.0/3.0 - 0.5)).xyz +
+                readColor(TexCoords.xy + dir * (3.0/3.0 - 0.5)).xyz);
             float lumaB = dot(rgbB, luma);
 
             if((lumaB < lumaMin) || (lumaB > lumaMax)){
@@ -100,13 +107,15 @@ inline Shader& getDeferredShader() {
              * Retrieve the depth from the gbuffer
              * and apply ambient occlusion
              */
-            linearDistance = -texture(gPosition, TexCoords).z;
+            bool background = isBackground(TexCoords);
+            // The sky is at the far plane, whatever the layout leaves in the gbuffer there
+            linearDistance = background ? zFar : readDepth(TexCoords);
 
-            if (linearDistance < zFar) {
+            if (!background) {
                 // No ssao for the sky
-                shadedPass.rgb *= blurredSSAO(linearDistance);
+                shadedPass.rgb *= bilateral ? upsampledSSAO(linearDistance) : texture(ssaoPass, TexCoords).r;
             }
         }
-    ), __FILE__ };
-    return shader;
+    ), getGBufferReader(layout)), __FILE__, layout.getName()));
+    return *shader;
 }
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+#include "../wrapper/Shader.h"
+#include "GBufferLayout.h"
+#include <map>
+
+/**
+ * Writes the linear depth at the resolution of the target
+ * Alternates between the min and max of the covered texels in a checkerboard,
+ * so both sides of an edge survive the downsampling
+ * https://www.gdcvault.com/play/1022538/Low-Resolution-Effects-with-Depth
+ */
+inline Shader& getDepthDownsampleShader(const GBufferLayout& layout = {}) {
+    static std::map<int, std::unique_ptr<Shader>> variants;
+    std::unique_ptr<Shader>& shader = variants[layout.key()];
+    if (shader != nullptr) { return *shader; }
+    shader.reset(new Shader(Shader::getBillboardVertexShader(), Shader::include(GLSL(
+        layout (location = 0) out float ssaoDepth;
+        in vec2 TexCoords;
+
+        uniform vec2 pixelSize; // The size of a pixel of the target
+        uniform float zFar;
+
+        float depthAt(vec2 uv) {
+            // The sky is pushed to the far plane in every layout
+            return isBackground(uv) ? zFar : readDepth(uv);
+        }
+
+        void main() {
+            vec2 o = pixelSize * 0.25;
+            float a = depthAt(TexCoords + vec2(-o.x, -o.y));
+            float b = depthAt(TexCoords + vec2( o.x, -o.y));
+            float c = depthAt(TexCoords + vec2(-o.x,  o.y));
+            float d = depthAt(TexCoords + vec2( o.x,  o.y));
+
+            ivec2 pixel = ivec2(gl_FragCoord.xy);
+            if (((pixel.x + pixel.y) & 1) == 0) {
+                ssaoDepth = min(min(a, b), min(c, d));
+            } else {
+                ssaoDepth = max(max(a, b), max(c, d));
+            }
+        }
+    ), getGBufferReader(layout)), __FILE__, layout.getName()));
+    return *shader;
+}
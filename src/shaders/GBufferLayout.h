@@ -0,0 +1,323 @@
+#pragma once
+#include "../wrapper/Shader.h"
+#include "../wrapper/FrameBufferObject.h"
+
+/**
+ * Describes what the GBuffer stores and how the other passes read it back
+ */
+struct GBufferLayout {
+    enum Normals {
+        NORMAL_RGB16F = 0, // Plain view space normal
+        NORMAL_OCT16, // Octahedral encoded in RG16
+        NORMAL_OCT8 // Octahedral encoded and dithered in RG8
+    };
+
+    /**
+     * Don't store the view space position, but reconstruct it from
+     * the hardware depth buffer and the projection matrix
+     */
+    bool reconstructPosition = false;
+
+    Normals normals = NORMAL_RGB16F;
+
+    /**
+     * Color and octahedral normal packed into a single RG32UI target
+     * Always reconstructs the position
+     */
+    bool packed = false;
+
+    bool positionFromDepth() const {
+        return reconstructPosition || packed;
+    }
+
+    /**
+     * Used to tell the shader variants apart
+     */
+    int key() const {
+        if (packed) { return 1 << 3; }
+        return (reconstructPosition ? 1 : 0) | (int(normals) << 1);
+    }
+
+    /**
+     * Tells the variants apart in the files of the hot reload, e.g. SSAOShader.oct16.depth.frag
+     */
+    std::string getName() const {
+        if (packed) { return "packed"; }
+        const char* names[] = { "rgb16f", "oct16", "oct8" };
+        return std::string(names[normals]) + (reconstructPosition ? ".depth" : "");
+    }
+
+    /**
+     * Rough estimate how many bytes get written per pixel
+     */
+    int bytesPerPixel() const {
+        const int depth = 4;
+        if (packed) { return depth + 8; }
+        const int normal = normals == NORMAL_RGB16F ? 6 : (normals == NORMAL_OCT16 ? 4 : 2);
+        return depth + normal + 4 + (reconstructPosition ? 0 : 6);
+    }
+
+    /**
+     * Adds the textures to the GBuffer FBO
+     */
+    void configure(FrameBufferObject::FrameBufferConfig& c) const {
+        if (packed) {
+            c.addRG32UI("gPacked");
+            c.addZBuffer();
+            return;
+        }
+        if (!reconstructPosition) {
+            c.addRGB16F("gPosition");
+        }
+        if (normals == NORMAL_OCT16) {
+            c.addRG16("gNormal");
+        } else if (normals == NORMAL_OCT8) {
+            c.addRG8("gNormal");
+        } else {
+            c.addRGB16F("gNormal");
+        }
+        c.addRGBA8("gColor");
+        c.addZBuffer();
+    }
+};
+
+/**
+ * Octahedral normal encoding and bit packing used by the writer and reader
+ * http://jcgt.org/published/0003/02/01/
+ */
+inline std::string getGBufferCodec() {
+    return GLSL_CHUNK(
+        vec2 octWrap(vec2 v) {
+            return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+        }
+
+        /**
+         * Unit vector to the range 0.0 - 1.0
+         */
+        vec2 encodeNormal(vec3 n) {
+            n /= abs(n.x) + abs(n.y) + abs(n.z);
+            n.xy = n.z >= 0.0 ? n.xy : octWrap(n.xy);
+            return n.xy * 0.5 + 0.5;
+        }
+
+        vec3 decodeNormal(vec2 e) {
+            e = e * 2.0 - 1.0;
+            vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+            float t = clamp(-n.z, 0.0, 1.0);
+            n.x += n.x >= 0.0 ? -t : t;
+            n.y += n.y >= 0.0 ? -t : t;
+            return normalize(n);
+        }
+
+        uint packColor(vec4 c) {
+            uvec4 u = uvec4(round(clamp(c, 0.0, 1.0) * 255.0));
+            return u.r | (u.g << 8) | (u.b << 16) | (u.a << 24);
+        }
+
+        vec4 unpackColor(uint p) {
+            return vec4(uvec4(p, p >> 8, p >> 16, p >> 24) & 0xFFu) / 255.0;
+        }
+
+        uint packNormal(vec2 e) {
+            uvec2 u = uvec2(round(clamp(e, 0.0, 1.0) * 65535.0));
+            return u.x | (u.y << 16);
+        }
+
+        vec2 unpackNormal(uint p) {
+            return vec2(uvec2(p, p >> 16) & 0xFFFFu) / 65535.0;
+        }
+    );
+}
+
+/**
+ * Outputs of the GBuffer shader
+ * Provides writeGBuffer() which takes view space position, normal and color
+ */
+inline std::string getGBufferWriter(const GBufferLayout& layout) {
+    std::string code = getGBufferCodec();
+    if (layout.packed) {
+        return code + GLSL_CHUNK(
+            layout (location = 0) out uvec2 gPacked;
+
+            void writeGBuffer(vec3 position, vec3 normal, vec4 color) {
+                gPacked = uvec2(packColor(color), packNormal(encodeNormal(normal)));
+            }
+        );
+    }
+
+    int location = 0;
+    if (!layout.reconstructPosition) {
+        code += GLSL_CHUNK(
+            layout (location = 0) out vec3 gPosition;
+        );
+        location++;
+    }
+
+    const std::string normalLocation = std::to_string(location++);
+    const std::string colorLocation = std::to_string(location++);
+    if (layout.normals == GBufferLayout::NORMAL_RGB16F) {
+        code += "layout (location = " + normalLocation + ") out vec3 gNormal;\n";
+        code += GLSL_CHUNK(
+            vec3 encodeGBufferNormal(vec3 n) {
+                return n;
+            }
+        );
+    } else if (layout.normals == GBufferLayout::NORMAL_OCT16) {
+        code += "layout (location = " + normalLocation + ") out vec2 gNormal;\n";
+        code += GLSL_CHUNK(
+            vec2 encodeGBufferNormal(vec3 n) {
+                return encodeNormal(n);
+            }
+        );
+    } else {
+        code += "layout (location = " + normalLocation + ") out vec2 gNormal;\n";
+        code += GLSL_CHUNK(
+            /**
+             * Dither before the quantization to 8 bit, so there is no visible banding
+             */
+            vec2 encodeGBufferNormal(vec3 n) {
+                float dither = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+                return encodeNormal(n) + (dither - 0.5) / 255.0;
+            }
+        );
+    }
+    code += "layout (location = " + colorLocation + ") out vec4 gColor;\n";
+
+    if (layout.reconstructPosition) {
+        return code + GLSL_CHUNK(
+            void writeGBuffer(vec3 position, vec3 normal, vec4 color) {
+                gNormal = encodeGBufferNormal(normal);
+                gColor = color;
+            }
+        );
+    }
+    return code + GLSL_CHUNK(
+        void writeGBuffer(vec3 position, vec3 normal, vec4 color) {
+            gPosition = position;
+            gNormal = encodeGBufferNormal(normal);
+            gColor = color;
+        }
+    );
+}
+
+/**
+ * Functions to read the GBuffer in the later passes
+ * readPosition() returns the view space position
+ * readDepth() the linear distance from the camera plane
+ * readNormal() the view space normal
+ * readColor() the unshaded color
+ * gBufferSize() the resolution of the GBuffer
+ * isBackground() is true where nothing was rendered
+ * viewPositionFromDepth() turns a linear depth back into a view space position
+ * Also declares the projection matrix and background color, so they have to be set
+ */
+inline std::string getGBufferReader(const GBufferLayout& layout) {
+    std::string code = getGBufferCodec() + GLSL_CHUNK(
+        uniform sampler2D zBuffer;
+        uniform mat4 projection;
+        uniform vec4 background;
+
+        vec2 gBufferSize() {
+            return vec2(textureSize(zBuffer, 0));
+        }
+
+        bool isBackground(vec2 uv) {
+            return texture(zBuffer, uv).r == 1.0;
+        }
+
+        /**
+         * View space position from a linear depth, the projection is symmetric
+         * so only the diagonal is needed
+         */
+        vec3 viewPositionFromDepth(vec2 uv, float depth) {
+            vec2 ndc = uv * 2.0 - 1.0;
+            return vec3(
+                ndc.x * depth / projection[0][0],
+                ndc.y * depth / projection[1][1],
+                -depth
+            );
+        }
+    );
+
+    if (layout.positionFromDepth()) {
+        code += GLSL_CHUNK(
+            /**
+             * Inverse of the perspective projection for a single depth value,
+             * cheaper than a full inverse matrix multiplication
+             */
+            float readDepth(vec2 uv) {
+                float ndcZ = texture(zBuffer, uv).r * 2.0 - 1.0;
+                return projection[3][2] / (ndcZ + projection[2][2]);
+            }
+
+            vec3 readPosition(vec2 uv) {
+                return viewPositionFromDepth(uv, readDepth(uv));
+            }
+        );
+    } else {
+        code += GLSL_CHUNK(
+            uniform sampler2D gPosition;
+
+            float readDepth(vec2 uv) {
+                return -texture(gPosition, uv).z;
+            }
+
+            vec3 readPosition(vec2 uv) {
+                return texture(gPosition, uv).xyz;
+            }
+        );
+    }
+
+    if (layout.packed) {
+        return code + GLSL_CHUNK(
+            uniform usampler2D gPacked;
+
+            /**
+             * Integer textures can't be filtered, so just take the closest texel
+             */
+            uvec2 readPacked(vec2 uv) {
+                ivec2 size = textureSize(gPacked, 0);
+                ivec2 texel = clamp(ivec2(uv * vec2(size)), ivec2(0), size - 1);
+                return texelFetch(gPacked, texel, 0).rg;
+            }
+
+            vec3 readNormal(vec2 uv) {
+                return decodeNormal(unpackNormal(readPacked(uv).y));
+            }
+
+            vec4 readColor(vec2 uv) {
+                if (isBackground(uv)) {
+                    return background; // Nothing was rendered here
+                }
+                return unpackColor(readPacked(uv).x);
+            }
+        );
+    }
+
+    code += GLSL_CHUNK(
+        uniform sampler2D gColor;
+
+        vec4 readColor(vec2 uv) {
+            return texture(gColor, uv);
+        }
+    );
+
+    if (layout.normals == GBufferLayout::NORMAL_RGB16F) {
+        code += GLSL_CHUNK(
+            uniform sampler2D gNormal;
+
+            vec3 readNormal(vec2 uv) {
+                return texture(gNormal, uv).rgb;
+            }
+        );
+    } else {
+        code += GLSL_CHUNK(
+            uniform sampler2D gNormal;
+
+            vec3 readNormal(vec2 uv) {
+                return decodeNormal(texture(gNormal, uv).rg);
+            }
+        );
+    }
+    return code;
+}
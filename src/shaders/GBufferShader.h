@@ -1,13 +1,18 @@
 #pragma once
 #include "../wrapper/Shader.h"
+#include "GBufferLayout.h"
+#include <map>
 
 /**
  * GBuffer shader wich renders positions normals and colors into textures
  * https://learnopengl.com/code_viewer_gh.php?code=src/5.advanced_lighting/9.ssao/9.ssao_geometry.vs
  * https://learnopengl.com/code_viewer_gh.php?code=src/5.advanced_lighting/9.ssao/9.ssao_geometry.fs
  */
-inline Shader &getGBufferShader() {
-    static Shader shader = {GLSL(
+inline Shader &getGBufferShader(const GBufferLayout& layout = {}) {
+    static std::map<int, std::unique_ptr<Shader>> variants;
+    std::unique_ptr<Shader>& shader = variants[layout.key()];
+    if (shader != nullptr) { return *shader; }
+    shader.reset(new Shader(GLSL(
         layout (location = 0) in vec3 aPos;
         layout (location = 1) in vec3 aNormal;
         layout (location = 2) in vec2 aTexCoords;
@@ -30,10 +35,7 @@ inline Shader &getGBufferShader() {
 
             gl_Position = projection * viewPos;
         }
-    ), GLSL(
-        layout (location = 0) out vec3 gPosition;
-        layout (location = 1) out vec3 gNormal;
-        layout (location = 2) out vec4 gColor;
+    ), Shader::include(GLSL(
         in vec2 TexCoords;
         in vec3 FragPos;
         in vec3 Normal;
@@ -53,11 +55,9 @@ inline Shader &getGBufferShader() {
             if (color.a < 0.01) {
                 discard;
             } else {
-                gPosition = FragPos;
-                gNormal = normalize(Normal);
-                gColor = color;
+                writeGBuffer(FragPos, normalize(Normal), color);
             }
         }
-    ), __FILE__ };
-    return shader;
+    ), getGBufferWriter(layout)), __FILE__, layout.getName()));
+    return *shader;
 }
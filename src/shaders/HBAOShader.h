@@ -0,0 +1,48 @@
+#pragma once
+#include "SSAOShader.h"
+
+/**
+ * Horizon based ambient occlusion, marches a few fixed directions in screen space
+ * and accumulates how far the depth rises above the tangent plane
+ * Uses the same inputs and interleaving as the SSAO shader
+ * https://developer.download.nvidia.com/presentations/2008/SIGGRAPH/HBAO_SIG08b.pdf
+ */
+inline Shader& getHbaoShader(const GBufferLayout& layout = {}) {
+    static std::map<int, std::unique_ptr<Shader>> variants;
+    std::unique_ptr<Shader>& shader = variants[layout.key()];
+    if (shader != nullptr) { return *shader; }
+    shader.reset(new Shader(Shader::getBillboardVertexShader(), Shader::include(GLSL(
+        uniform int directions = 4;
+        uniform int steps = 4;
+
+        float occlusion(vec2 uv, float rotation) {
+            // Radius projected into pixels of the ssao resolution
+            float radiusPixels = radius * projection[1][1] * 0.5 * ssaoSize.y / -fragPos.z;
+            if (radiusPixels < 1.0) { return 1.0; }
+            float stepPixels = radiusPixels / float(steps + 1);
+            float negInvR2 = -1.0 / (radius * radius);
+            float jitter = fract(rotation * 1.61803398875 + 0.5); // Decorrelated from the rotation
+
+            float ao = 0.0;
+            float angleStep = 6.28318530718 / float(directions);
+            for (int d = 0; d < directions; d++) {
+                float angle = angleStep * (float(d) + rotation);
+                vec2 direction = vec2(cos(angle), sin(angle));
+                float rayPixels = jitter * stepPixels + 1.0;
+                for (int s = 0; s < steps; s++) {
+                    // Snap to pixel centers, so the position matches the depth
+                    vec2 snapped;
+                    float depth = fetchDepth(uv + round(rayPixels * direction) / ssaoSize, snapped);
+                    vec3 v = viewPositionFromDepth(snapped, depth) - fragPos;
+                    float vv = dot(v, v);
+                    float nv = dot(normal, v) * inversesqrt(vv);
+                    ao += clamp(nv - bias, 0.0, 1.0) * clamp(vv * negInvR2 + 1.0, 0.0, 1.0);
+                    rayPixels += stepPixels;
+                }
+            }
+            ao /= float(directions * steps) * (1.0 - bias);
+            return clamp(1.0 - ao * 2.0, 0.0, 1.0);
+        }
+    ), getGBufferReader(layout) + getSsaoCommon()), __FILE__, layout.getName()));
+    return *shader;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "../wrapper/Shader.h"
+
+/**
+ * Rearranges a single channel texture between the full resolution and a 4x4 atlas of layers,
+ * where each layer holds every 4th pixel of the screen
+ * Render into a target of 4 * layerSize to deinterleave and into the screen sized one to go back
+ * https://developer.nvidia.com/sites/default/files/akamai/gameworks/samples/DeinterleavedTexturing.pdf
+ */
+inline Shader& getInterleaveShader() {
+    static Shader shader = { Shader::getBillboardVertexShader(), GLSL(
+        layout (location = 0) out float interleaved;
+
+        uniform sampler2D interleaveInput;
+        uniform ivec2 layerSize;
+        uniform bool deinterleave;
+
+        void main() {
+            ivec2 pixel = ivec2(gl_FragCoord.xy);
+            ivec2 texel;
+            if (deinterleave) {
+                ivec2 layer = pixel / layerSize;
+                texel = (pixel - layer * layerSize) * 4 + layer;
+            } else {
+                texel = (pixel % 4) * layerSize + pixel / 4;
+            }
+            // The atlas is padded, so the last layers can reach over the edge
+            ivec2 size = textureSize(interleaveInput, 0);
+            interleaved = texelFetch(interleaveInput, clamp(texel, ivec2(0), size - 1), 0).r;
+        }
+    ), __FILE__, "interleave" };
+    return shader;
+}
@@ -1,84 +1,115 @@
 #pragma once
-#include "../wrapper/Shader.h"
+#include "../wrapper/ShaderPermutations.h"
+#include <string>
+
+// Lattice cells of the grain texture in each direction, see generateGrainNoise()
+const int GRAIN_CELLS = 128;
 
 
 /**
- * Post shader
- * Sensor crop, Barrel Distortion, Dispersion, Vignetting, Film Grain and basic Exposure
+ * Vignette, film grain and exposure, everything of the post effects that only needs the pixel itself
+ * The last DOF pass can end with them (FUSED_POST), which saves the full screen post pass
+ * VIGNETTE and GRAIN have to be defined, see withPostDefines()
+ * The post pass passes in the vignette from the lens map, the others compute it
  */
-inline Shader& getPostShader() {
-    static Shader shader = { Shader::getBillboardVertexShader() , GLSL(
-        out vec3 FragColor;
-        in vec2 TexCoords;
-
-        uniform sampler2D gColorSoft; //Image to be processed
-
+inline std::string getPostChunk() {
+    return "const float GRAIN_CELLS = " + std::to_string(GRAIN_CELLS) + ".0;\n" + GLSL_CHUNK(
+        uniform bool fusedPost = false;
         uniform float vignetteStrength = 1.0;
         uniform float vignetteFalloff = 1.0;
         uniform float vignetteDesaturation = 0.0;
-        uniform float dispersionFalloff = 1.0;
-        uniform float dispersion = 1.0;
-        uniform float barrelDistortion = 1.0;
-        uniform float barrelDistortionFalloff = 1.0;
-        uniform float aspectRatio = 1.777;
-        uniform float crop = 0.0;
+        uniform float outputAspectRatio = 1.777;
         uniform float grain = 1.0;
         uniform float grainSize = 1.0;
-        uniform float time = 0.0;
+        uniform sampler2D grainNoise;
+        uniform vec2 grainOffset = vec2(0.0); // Moves the grain every frame
         uniform float exposure = 1.0;
 
-        const float eps = 0.001;
-
-        /**
-         *  Noise from https://www.shadertoy.com/view/4sfGzS
-         */
-        float hash(vec3 p) {
-            p  = fract( p*0.3183099+.1 );
-            p *= 17.0;
-            return fract(p.x * p.y * p.z * (p.x + p.y + p.z));
+        float getVignette(vec2 uv) {
+            // Distance from the center
+            float fromCenterLength = length((vec2(0.5, 0.5) - uv) * vec2(outputAspectRatio, 1.0));
+            return pow(fromCenterLength, vignetteFalloff) * vignetteStrength;
         }
 
-        float noise( in vec3 x ) {
-            vec3 i = floor(x);
-            vec3 f = fract(x);
-            f = f * f * (3.0 - 2.0 * f);
-    
-            return mix(
-                mix(
-                    mix(hash(i + vec3(0, 0, 0)),  hash(i + vec3(1, 0, 0)), f.x),
-                    mix(hash(i + vec3(0, 1, 0)),  hash(i + vec3(1, 1, 0)), f.x),
-                    f.y
-                ),
-                mix(
-                    mix(hash(i+vec3(0, 0, 1)),  hash(i+vec3(1, 0, 1)), f.x),
-                    mix(hash(i+vec3(0, 1, 1)),  hash(i+vec3(1 ,1 ,1)), f.x),
-                    f.y
-                ),
-                f.z
-            );
+        vec3 applyPost(vec3 color, vec2 uv, float vignette) {
+            /**
+             * Vignette
+             */
+            if (VIGNETTE) {
+                // Apply the vignette by multiplying
+                color *= 1.0 - vignette;
+                // Desaturate the edges
+                color = mix(color, vec3(length(color)), vignette * vignetteDesaturation);
+            }
+
+            /**
+             * Film Grain
+             */
+            if (GRAIN) {
+                /**
+                 * A cell of the noise every 1000th of the screen height at size 1,
+                 * the random offset per frame makes it change between frames
+                 */
+                vec2 grainUv = uv * grainSize * 1000.0 * vec2(outputAspectRatio, 1.0) / GRAIN_CELLS;
+                vec3 n = vec3(texture(grainNoise, grainUv + grainOffset).r);
+                /**
+                 * Apply the noise by multipling and adding a small amount
+                 * so the noise is also visible in darker areas. Sensor noise usually is
+                 */
+                color = mix(color, color * n + n * 0.2, grain);
+            }
+
+            return color * exposure;
         }
 
-        vec3 ACESFilm(vec3 x) {
-            float a = 2.51;
-            float b = 0.03;
-            float c = 2.43;
-            float d = 0.59;
-            float e = 0.14;
-            return (x*(a*x+b))/(x*(c*x+d)+e);
+        vec3 applyPost(vec3 color, vec2 uv) {
+            return applyPost(color, uv, getVignette(uv));
         }
+    );
+}
+
+/**
+ * Adds the defines of getPostChunk() to the ones of a shader, FUSED_POST switches it on
+ */
+inline ShaderDefines withPostDefines(ShaderDefines defines) {
+    defines["FUSED_POST"] = "fusedPost";
+    defines["VIGNETTE"] = "(vignetteStrength != 0.0)";
+    defines["GRAIN"] = "(grain > 0.001)";
+    return defines;
+}
+
+/**
+ * Bakes everything of the post shader that only depends on the lens and the resolution
+ * lensUv: where the image is sampled (negative outside of it) and the dispersion offset
+ * lensVignette: the vignette before it's applied
+ */
+inline Shader& getLensMapShader() {
+    static Shader shader = { Shader::getBillboardVertexShader(), GLSL(
+        layout (location = 0) out vec4 lensUv;
+        layout (location = 1) out float lensVignette;
+        in vec2 TexCoords;
+
+        uniform float outputAspectRatio = 1.777;
+        uniform float crop = 0.0;
+        uniform float barrelDistortion = 1.0;
+        uniform float barrelDistortionFalloff = 1.0;
+        uniform float dispersion = 1.0;
+        uniform float dispersionFalloff = 1.0;
+        uniform float vignetteStrength = 1.0;
+        uniform float vignetteFalloff = 1.0;
 
         void main() {
-            vec2 uv = TexCoords;
-            
             /**
              * Sensor Crop
              */
-            uv = uv * (1.0 - crop) + crop * 0.5;
-            
+            vec2 uv = TexCoords * (1.0 - crop) + crop * 0.5;
+
             // Vector pointing away from the center
-            vec2 fromCenter = (vec2(0.5, 0.5) - uv) * vec2(aspectRatio, 1.0);
+            vec2 fromCenter = (vec2(0.5, 0.5) - uv) * vec2(outputAspectRatio, 1.0);
             float fromCenterLength = length(fromCenter);
 
+            lensVignette = pow(fromCenterLength, vignetteFalloff) * vignetteStrength;
+
             /**
              * Barrel Distortion
              */
@@ -91,6 +122,56 @@ inline Shader& getPostShader() {
                  * Black out the border of the screen, since it might
                  * be visible after ctopping or adding the barrel distortion
                  */
+                lensUv = vec4(-1.0);
+                return;
+            }
+
+            /**
+             * Dispersion/Chromatic aberration strength
+             */
+            vec2 disp = fromCenter * pow(fromCenterLength, dispersionFalloff) * dispersion * (1.0 + abs(dispersion - 1.0));
+            lensUv = vec4(baseUv, disp);
+        }
+    ), __FILE__, "lensMap" };
+    return shader;
+}
+
+/**
+ * Post shader
+ * Sensor crop, Barrel Distortion, Dispersion and the effects of getPostChunk()
+ * The lens part comes from the map of getLensMapShader()
+ * DISPERSION, VIGNETTE and GRAIN can be switched off per variant
+ */
+inline ShaderPermutations& getPostShader() {
+    static ShaderPermutations shader = { Shader::getBillboardVertexShader() , Shader::include(GLSL(
+        out vec3 FragColor;
+        in vec2 TexCoords;
+
+        uniform sampler2D gColorSoft; //Image to be processed
+        uniform sampler2D lensUv; // From getLensMapShader()
+        uniform sampler2D lensVignette;
+
+        uniform float dispersion = 1.0;
+        uniform float crop = 0.0;
+
+        const float eps = 0.001;
+
+        vec3 ACESFilm(vec3 x) {
+            float a = 2.51;
+            float b = 0.03;
+            float c = 2.43;
+            float d = 0.59;
+            float e = 0.14;
+            return (x*(a*x+b))/(x*(c*x+d)+e);
+        }
+
+        void main() {
+            vec4 lens = texture(lensUv, TexCoords);
+            // The Base UV before dispersion
+            vec2 baseUv = lens.xy;
+
+            if (baseUv.x < 0.0) {
+                // Outside of the image after cropping or the barrel distortion
                 FragColor = vec3(0);
                 return;
             }
@@ -100,13 +181,11 @@ inline Shader& getPostShader() {
              */
             vec3 color = vec3(0);
 
-            if (abs(dispersion) < eps) {
+            if (!DISPERSION) {
                 // No disperion
                 color = texture(gColorSoft, baseUv).rgb;
             } else {
-                vec2 disp = fromCenter;
-                // Calc dispersion strength
-                disp *= pow(fromCenterLength, dispersionFalloff) * dispersion * (1.0 + abs(dispersion - 1.0));
+                vec2 disp = lens.zw;
                 color.r  += texture(gColorSoft, baseUv                 ).r  * 0.66;
                 color.rg += texture(gColorSoft, baseUv + (disp * 0.005)).rg * 0.33;
                 color.g  += texture(gColorSoft, baseUv + (disp * 0.001)).g  * 0.33;
@@ -114,36 +193,14 @@ inline Shader& getPostShader() {
                 color.b  += texture(gColorSoft, baseUv + (disp * 0.003)).b  * 0.66;
             }
 
-            /**
-             * Vignette
-             */
-            float vignette = pow(fromCenterLength, vignetteFalloff) * vignetteStrength;
-            // Apply the vignette by multiplying
-            color *= 1.0 - vignette;
-            // Desaturate the edges
-            color = mix(color, vec3(length(color)), vignette * vignetteDesaturation);
-            
-
-            /**
-             * Film Grain
-             */
-            if (grain > eps) {
-                /**
-                 * Create 3D coordinates for the noise by using the UVs and
-                 * the time as the z coordinate so the noise changes between frames
-                 */
-                vec3 n = vec3(noise(vec3(uv * grainSize * 1000.0 * vec2(aspectRatio, 1.0), time * 1000.0)));
-                /**
-                 * Apply the noise by multipling and adding a small amount
-                 * so the noise is also visible in darker areas. Sensor noise usually is
-                 */
-                color = mix(color, color * n + n * 0.2, grain);
-            }
-
-            color = (color * exposure);
-
-            FragColor = color;
+            // The cropped UVs like in the lens map, for the grain
+            vec2 uv = TexCoords * (1.0 - crop) + crop * 0.5;
+            FragColor = applyPost(color, uv, texture(lensVignette, TexCoords).r);
         }
-    ), __FILE__ };
+    ), getPostChunk()), {
+        { "DISPERSION", "(abs(dispersion) >= eps)" },
+        { "VIGNETTE", "(vignetteStrength != 0.0)" },
+        { "GRAIN", "(grain > 0.001)" }
+    }, __FILE__ };
     return shader;
 }
\ No newline at end of file
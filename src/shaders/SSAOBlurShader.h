@@ -0,0 +1,68 @@
+#pragma once
+#include "../wrapper/Shader.h"
+
+/**
+ * One direction of a separable bilateral blur for the SSAO
+ * Samples across a depth discontinuity get rejected, so the
+ * occlusion doesn't leak onto the background
+ */
+inline Shader& getSsaoBlurShader() {
+    static Shader shader = { Shader::getBillboardVertexShader(), GLSL(
+        layout (location = 0) out float ssaoBlurred;
+        in vec2 TexCoords;
+
+        uniform sampler2D ssaoInput; // Needs linear filtering for linearSampling
+        uniform sampler2D ssaoDepth;
+        uniform vec2 direction; // One pixel along the blur direction
+        uniform int radius = 4;
+        uniform float sharpness = 16.0;
+        /**
+         * Let the texture unit blend two neighbouring texels, which halves the taps
+         * The depth weights are still per texel, they move the tap between the two
+         * https://www.rastergrid.com/blog/2010/09/efficient-gaussian-blur-with-linear-sampling/
+         */
+        uniform bool linearSampling = true;
+
+        float gauss(float x, float sigma) {
+            return exp(-(x * x) / (2.0 * sigma * sigma));
+        }
+
+        float centerDepth;
+
+        /**
+         * Spatial and depth weight of the texel i pixels away along the direction
+         */
+        float getWeight(int i, float sigma) {
+            ivec2 size = textureSize(ssaoDepth, 0);
+            ivec2 texel = ivec2(gl_FragCoord.xy) + ivec2(round(direction * vec2(size))) * i;
+            float sampleDepth = texelFetch(ssaoDepth, clamp(texel, ivec2(0), size - 1), 0).r;
+            float range = abs(sampleDepth - centerDepth) / centerDepth;
+            return gauss(float(i), sigma) * exp(-range * sharpness);
+        }
+
+        void main() {
+            centerDepth = texelFetch(ssaoDepth, ivec2(gl_FragCoord.xy), 0).r;
+            float result = texture(ssaoInput, TexCoords).r;
+            float weights = 1.0;
+            float sigma = float(radius) * 0.5 + 0.5;
+            int taps = linearSampling ? 2 : 1;
+
+            for (int i = 1; i <= radius; i += taps) {
+                for (int side = -1; side <= 1; side += 2) {
+                    float w0 = getWeight(i * side, sigma);
+                    float w1 = (linearSampling && i < radius) ? getWeight((i + 1) * side, sigma) : 0.0;
+                    float w = w0 + w1;
+                    if (w <= 0.0) {
+                        continue;
+                    }
+                    // Position between the two texels where the filtering blends them in the ratio of their weights
+                    float offset = float(i) + w1 / w;
+                    result += texture(ssaoInput, TexCoords + direction * offset * float(side)).r * w;
+                    weights += w;
+                }
+            }
+            ssaoBlurred = result / weights;
+        }
+    ), __FILE__, "blur" };
+    return shader;
+}
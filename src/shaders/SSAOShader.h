@@ -1,49 +1,170 @@
 #pragma once
 #include "../wrapper/Shader.h"
+#include "GBufferLayout.h"
+#include <map>
+#include <vector>
+#include <cmath>
 
 /**
- * Slightly altered version of
- * https://learnopengl.com/code_viewer_gh.php?code=src/5.advanced_lighting/9.ssao/9.ssao.fs
- * Doens't use the noise texture and kernel for convenience
+ * Size of the kernel uniform block, the samples slider can't go beyond it
+ */
+const int SSAO_MAX_SAMPLES = 256;
+const GLuint SSAO_KERNEL_BINDING = 0;
+
+/**
+ * Radical inverse in the given base, used for the low discrepancy kernel
  */
-inline Shader& getSsaoShader() {
-    static Shader shader = { Shader::getBillboardVertexShader(), GLSL(
+inline float ssaoRadicalInverse(unsigned int i, unsigned int base) {
+    float inverse = 1.f / float(base), f = inverse, result = 0.f;
+    for (; i > 0; i /= base, f *= inverse) {
+        result += f * float(i % base);
+    }
+    return result;
+}
+
+/**
+ * Hemisphere kernel for the SSAO, evenly spread with a Hammersley set instead of random numbers
+ * and scaled so more samples are close to the center like in the learnopengl version
+ * Padded to vec4 for the std140 layout of the uniform block
+ */
+inline std::vector<glm::vec4> getSsaoKernel(int count) {
+    count = clamp(count, 1, SSAO_MAX_SAMPLES);
+    std::vector<glm::vec4> kernel(count);
+    for (int i = 0; i < count; i++) {
+        const float z = (float(i) + 0.5f) / float(count);
+        const float phi = 2.f * float(M_PI) * ssaoRadicalInverse(i, 2);
+        const float r = std::sqrt(1.f - z * z);
+        float scale = ssaoRadicalInverse(i, 3);
+        scale = 0.1f + 0.9f * scale * scale;
+        kernel[i] = glm::vec4(glm::vec3(r * std::cos(phi), r * std::sin(phi), z) * scale, 0.f);
+    }
+    return kernel;
+}
+
+/**
+ * Everything the ambient occlusion techniques share, they only implement occlusion()
+ * which gets called with fragPos and normal already set and returns 1.0 for no occlusion
+ *
+ * In the interleaved mode the depth is a 4x4 atlas made with the interleave shader,
+ * each layer of it uses the same rotation and only samples its own quarter resolution depth,
+ * which keeps the texture reads close together
+ */
+inline std::string getSsaoCommon() {
+    return GLSL_CHUNK(
         layout (location = 0) out float ssaoPass;
         in vec2 TexCoords;
-        uniform sampler2D gPosition;
-        uniform sampler2D gNormal;
         uniform float strength = 1.0;
         uniform float radius = 0.3;
         uniform float bias = 0.025;
-        uniform int count = 32;
+        uniform sampler2D ssaoDepth;
+        uniform sampler2D ssaoNoise; // Tiled rotations
+        uniform float frameOffset = 0.0; // Changes the rotations for temporal accumulation
+
+        uniform bool interleaved = false;
+        uniform ivec2 layerSize; // Size of a single layer of the atlas
+        uniform vec2 ssaoSize; // The resolution of the interleaved result
 
-        uniform mat4 projection;
+        ivec2 layer;
+        vec3 fragPos;
+        vec3 normal;
 
-        float rand(vec2 co) {
-            return fract(sin(dot(co.xy, vec2(12.9898, 78.233))) * 43758.5453);
+        float occlusion(vec2 uv, float rotation);
+
+        /**
+         * Ordered 4x4 rotations, so the 16 layers cover all directions evenly
+         */
+        float layerRotation(ivec2 l) {
+            const float bayer[16] = float[16](
+                0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0,
+                3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0
+            );
+            return (bayer[l.y * 4 + l.x] + 0.5) / 16.0;
         }
 
         /**
-         * To lazy to provide a kernel from outside, so just generate something similar
-         * This this is nosier but works
+         * Linear depth close to uv, snapped is where it really comes from
+         * In the interleaved mode that's the closest texel of the current layer
          */
-        vec3 randKernel(vec2 co) {
-            return vec3(1.0 - rand(co) * 2.0, 1.0 - rand(co * 20.0) * 2.0, rand(co - 20.0));
+        float fetchDepth(vec2 uv, out vec2 snapped) {
+            if (!interleaved) {
+                snapped = uv;
+                return texture(ssaoDepth, uv).r;
+            }
+            vec2 local = floor((uv * ssaoSize - 0.5 - vec2(layer)) * 0.25 + 0.5);
+            ivec2 texel = clamp(ivec2(local), ivec2(0), layerSize - 1);
+            snapped = (vec2(texel * 4 + layer) + 0.5) / ssaoSize;
+            return texelFetch(ssaoDepth, layer * layerSize + texel, 0).r;
         }
 
-        float ssao() {
-            vec3 fragPos = texture(gPosition, TexCoords).xyz;
-            if (fragPos.z > 0.0) { return 1.0; } // Sky can be skipped
-            vec3 normal = normalize(texture(gNormal, TexCoords).rgb);
-            vec3 randomVec = normalize(vec3(randKernel(fragPos.xy).xy, 0.0));
+        float ambientOcclusion(vec2 uv, float depth, float rotation) {
+            if (isBackground(uv)) { return 1.0; } // Sky can be skipped
+            fragPos = viewPositionFromDepth(uv, depth);
+            normal = normalize(readNormal(uv));
+            return occlusion(uv, fract(rotation + frameOffset));
+        }
+
+        void main() {
+            float ao = 1.0;
+            if (interleaved) {
+                ivec2 pixel = ivec2(gl_FragCoord.xy);
+                layer = pixel / layerSize;
+                ivec2 screenPixel = (pixel - layer * layerSize) * 4 + layer;
+                if (all(lessThan(vec2(screenPixel), ssaoSize))) { // Skip the padding
+                    vec2 uv = (vec2(screenPixel) + 0.5) / ssaoSize;
+                    ao = ambientOcclusion(uv, texelFetch(ssaoDepth, pixel, 0).r, layerRotation(layer));
+                }
+            } else {
+                float rotation = texture(ssaoNoise, gl_FragCoord.xy / vec2(textureSize(ssaoNoise, 0))).r;
+                ao = ambientOcclusion(TexCoords, texture(ssaoDepth, TexCoords).r, rotation);
+            }
+            ssaoPass = pow(ao, strength);
+        }
+    );
+}
+
+/**
+ * Slightly altered version of
+ * https://learnopengl.com/code_viewer_gh.php?code=src/5.advanced_lighting/9.ssao/9.ssao.fs
+ * The kernel comes from getSsaoKernel() and is rotated with a tiled blue noise texture
+ * Positions come from the downsampled linear depth, only the normal is read from the GBuffer
+ */
+inline Shader& getSsaoShader(const GBufferLayout& layout = {}) {
+    static std::map<int, std::unique_ptr<Shader>> variants;
+    std::unique_ptr<Shader>& shader = variants[layout.key()];
+    if (shader != nullptr) { return *shader; }
+    const std::string kernel =
+        "layout (std140) uniform SsaoKernel { vec4 ssaoKernel[" + std::to_string(SSAO_MAX_SAMPLES) + "]; };\n";
+    shader.reset(new Shader(Shader::getBillboardVertexShader(), Shader::include(GLSL(
+        uniform int count = 16;
+
+        /**
+         * Depth of the tangent plane of the fragment along the view ray through uv
+         */
+        float planeDepth(vec2 uv) {
+            float d = dot(normal, viewPositionFromDepth(uv, 1.0));
+            return dot(normal, fragPos) / (abs(d) < 0.0001 ? 0.0001 : d);
+        }
+
+        float sampleDepth(vec2 uv) {
+            vec2 snapped;
+            float depth = fetchDepth(uv, snapped);
+            if (!interleaved) { return depth; }
+            // The texel can be a few pixels off, so move the depth over along the tangent plane
+            // or flat surfaces at grazing angles start to occlude themselves
+            return depth + planeDepth(uv) - planeDepth(snapped);
+        }
+
+        float occlusion(vec2 uv, float rotation) {
+            float angle = rotation * 6.28318530718;
+            vec3 randomVec = vec3(cos(angle), sin(angle), 0.0);
             vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
             vec3 bitangent = cross(normal, tangent);
             mat3 TBN = mat3(tangent, bitangent, normal);
 
-            float occlusion = 0.0;
+            float ao = 0.0;
             for (int i = 0; i < count; i++) {
                 // get sample position
-                vec3 sample = TBN * randKernel(fragPos.xy * float(i)); // from tangent to view-space
+                vec3 sample = TBN * ssaoKernel[i].xyz; // from tangent to view-space
                 sample = fragPos + sample * radius;
 
                 // project sample position (to sample texture) (to get position on screen/texture)
@@ -53,20 +174,15 @@ inline Shader& getSsaoShader() {
                 offset.xyz = offset.xyz * 0.5 + 0.5; // transform to range 0.0 - 1.0
 
                 // get sample depth
-                float sampleDepth = texture(gPosition, offset.xy).z; // get depth value of kernel sample
+                float sampleZ = -sampleDepth(offset.xy); // get depth value of kernel sample
 
                 // range check & accumulate
-                float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
-                occlusion += (sampleDepth >= sample.z + bias ? 1.0 : 0.0) * rangeCheck;
+                float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleZ));
+                ao += (sampleZ >= sample.z + bias ? 1.0 : 0.0) * rangeCheck;
             }
-            occlusion = 1.0 - (occlusion / float(count));
-            return occlusion;
-        }
-
-        void main() {
-            float ao = ssao();
-            ssaoPass = pow(ao, strength);
+            return 1.0 - (ao / float(count));
         }
-    ), __FILE__ };
-    return shader;
+    ), kernel + getGBufferReader(layout) + getSsaoCommon()), __FILE__, layout.getName()));
+    shader->bindUniformBlock("SsaoKernel", SSAO_KERNEL_BINDING);
+    return *shader;
 }
@@ -0,0 +1,60 @@
+#pragma once
+#include "../wrapper/Shader.h"
+
+/**
+ * Blends the current frame into the history, which is reprojected with the matrices of the last frame,
+ * so noisy effects converge over a couple of frames instead of needing many samples
+ * The history gets clamped to the 3x3 neighbourhood of the current frame, which rejects most ghosting
+ * Works for any texture with a matching linear depth, unused channels are just carried along
+ */
+inline Shader& getTemporalShader() {
+    static Shader shader = { Shader::getBillboardVertexShader(), GLSL(
+        layout (location = 0) out vec4 temporal;
+        in vec2 TexCoords;
+
+        uniform sampler2D current;
+        uniform sampler2D history; // Needs linear filtering
+        uniform sampler2D depth; // Linear depth at the resolution of current
+        uniform mat4 projection;
+        uniform mat4 viewToPreviousClip; // From the current view space to the clip space of the last frame
+        uniform float feedback = 0.9; // How much of the history is kept
+        uniform bool clampHistory = true;
+        uniform bool reset = false; // There is no usable history, e.g. after a resize
+
+        void main() {
+            vec4 color = texture(current, TexCoords);
+            if (reset) {
+                temporal = color;
+                return;
+            }
+
+            float d = texture(depth, TexCoords).r;
+            vec2 ndc = TexCoords * 2.0 - 1.0;
+            vec3 viewPos = vec3(ndc.x * d / projection[0][0], ndc.y * d / projection[1][1], -d);
+            vec4 previous = viewToPreviousClip * vec4(viewPos, 1.0);
+            vec2 uv = previous.xy / previous.w * 0.5 + 0.5;
+            if (previous.w <= 0.0 || any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0)))) {
+                temporal = color; // Wasn't on screen in the last frame
+                return;
+            }
+
+            vec4 old = texture(history, uv);
+            if (clampHistory) {
+                ivec2 pixel = ivec2(gl_FragCoord.xy);
+                ivec2 size = textureSize(current, 0);
+                vec4 low = color;
+                vec4 high = color;
+                for (int y = -1; y <= 1; y++) {
+                    for (int x = -1; x <= 1; x++) {
+                        vec4 c = texelFetch(current, clamp(pixel + ivec2(x, y), ivec2(0), size - 1), 0);
+                        low = min(low, c);
+                        high = max(high, c);
+                    }
+                }
+                old = clamp(old, low, high);
+            }
+            temporal = mix(color, old, feedback);
+        }
+    ), __FILE__, "temporal" };
+    return shader;
+}
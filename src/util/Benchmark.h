@@ -0,0 +1,141 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "../wrapper/GpuProfiler.h"
+
+/**
+ * Frame times and GPU pass times of a benchmark run
+ * Every frame waits for the GPU at its end, so its work is counted in the frame and not the next one
+ */
+class Benchmark {
+public:
+    struct Stats {
+        float mean = 0.f, p50 = 0.f, p95 = 0.f, p99 = 0.f, min = 0.f, max = 0.f;
+    };
+
+private:
+    std::chrono::steady_clock::time_point frameStart;
+    std::vector<float> frameTimes; // Milliseconds on the CPU including the wait
+    std::vector<float> gpuTimes;
+    std::map<std::string, std::vector<float>> passTimes;
+    int gpuFrame = 0; // Next frame to read from the GpuProfiler
+
+public:
+    /**
+     * Throws away everything measured so far, call it after the warmup
+     */
+    void reset() {
+        getGpuProfiler().finish();
+        frameTimes.clear();
+        gpuTimes.clear();
+        passTimes.clear();
+        gpuFrame = getGpuProfiler().getTotalFrames();
+    }
+
+    void beginFrame() {
+        frameStart = std::chrono::steady_clock::now();
+    }
+
+    /**
+     * Call after the GpuProfiler ended the frame
+     */
+    void endFrame() {
+        GpuProfiler& profiler = getGpuProfiler();
+        profiler.finish();
+        frameTimes.push_back(std::chrono::duration<float, std::milli>(
+            std::chrono::steady_clock::now() - frameStart
+        ).count());
+
+        for (; gpuFrame < profiler.getTotalFrames(); gpuFrame++) {
+            gpuTimes.push_back(profiler.getValue(-1, gpuFrame));
+            for (int i = 0; i < profiler.getSectionCount(); i++) {
+                passTimes[profiler.getName(i)].push_back(profiler.getValue(i, gpuFrame));
+            }
+        }
+    }
+
+    size_t getFrameCount() const { return frameTimes.size(); }
+
+    static Stats getStats(std::vector<float> values) {
+        Stats stats;
+        if (values.empty()) { return stats; }
+        std::sort(values.begin(), values.end());
+        // Nearest rank, so every percentile is a frame that really happened
+        const auto percentile = [&](float p) {
+            const size_t rank = size_t(std::ceil(p * float(values.size())));
+            return values[rank > 0 ? rank - 1 : 0];
+        };
+        float sum = 0.f;
+        for (float v : values) { sum += v; }
+        stats.mean = sum / float(values.size());
+        stats.p50 = percentile(0.5f);
+        stats.p95 = percentile(0.95f);
+        stats.p99 = percentile(0.99f);
+        stats.min = values.front();
+        stats.max = values.back();
+        return stats;
+    }
+
+    Stats getFrameStats() const { return getStats(frameTimes); }
+    Stats getGpuStats() const { return getStats(gpuTimes); }
+
+    /**
+     * The settings are written as they are, so they have to be valid JSON values
+     */
+    bool writeJson(const std::string& path, const std::map<std::string, std::string>& settings) const {
+        std::ofstream file(path);
+        if (!file) {
+            std::cerr << "Can't write the benchmark results to " << path << "\n";
+            return false;
+        }
+        const auto writeStats = [&](const Stats& s) {
+            file << "{ \"mean\": " << s.mean << ", \"p50\": " << s.p50 << ", \"p95\": " << s.p95
+                << ", \"p99\": " << s.p99 << ", \"min\": " << s.min << ", \"max\": " << s.max << " }";
+        };
+
+        file << "{\n  \"settings\": {";
+        bool first = true;
+        for (auto& setting : settings) {
+            file << (first ? "\n" : ",\n") << "    \"" << setting.first << "\": " << setting.second;
+            first = false;
+        }
+        file << "\n  },\n  \"frames\": " << frameTimes.size() << ",\n  \"frameTime\": ";
+        writeStats(getFrameStats());
+        file << ",\n  \"gpuTime\": ";
+        writeStats(getGpuStats());
+        file << ",\n  \"passes\": {";
+        first = true;
+        for (auto& pass : passTimes) {
+            file << (first ? "\n" : ",\n") << "    \"" << pass.first << "\": ";
+            writeStats(getStats(pass.second));
+            first = false;
+        }
+        file << "\n  },\n  \"perFrame\": [";
+        for (size_t i = 0; i < frameTimes.size(); i++) {
+            file << (i == 0 ? "\n" : ",\n") << "    { \"frameTime\": " << frameTimes[i];
+            if (i < gpuTimes.size()) { file << ", \"gpuTime\": " << gpuTimes[i]; }
+            file << " }";
+        }
+        file << "\n  ]\n}\n";
+        return true;
+    }
+
+    void print() const {
+        const auto printStats = [](const std::string& name, const Stats& s) {
+            std::cout << name << ": mean " << s.mean << " ms, p50 " << s.p50 << ", p95 " << s.p95
+                << ", p99 " << s.p99 << "\n";
+        };
+        printStats("Frame", getFrameStats());
+        printStats("GPU", getGpuStats());
+        for (auto& pass : passTimes) {
+            printStats("  " + pass.first, getStats(pass.second));
+        }
+    }
+};
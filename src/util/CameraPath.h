@@ -0,0 +1,115 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <glm.hpp>
+
+#include "Camera.h"
+
+/**
+ * Camera and lens over time, interpolated linearly between keyframes
+ * A path file has one keyframe per line, # starts a comment:
+ * time x y z yaw pitch focusDistance aperture
+ */
+class CameraPath {
+public:
+    struct Keyframe {
+        float time = 0.f;
+        glm::vec3 position = glm::vec3(0.f);
+        float yaw = 0.f, pitch = 0.f;
+        float focusDistance = 0.f;
+        float aperture = 0.f;
+    };
+
+private:
+    std::vector<Keyframe> keyframes; // Sorted by time
+
+public:
+    /**
+     * A slow dolly through the default scene while pulling focus, used if no path is given
+     */
+    static CameraPath getDefault() {
+        CameraPath path;
+        path.add({ 0.f, glm::vec3(2.f, 3.f, 10.f), -95.f, -12.f, 9.f, 1.4f });
+        path.add({ 4.f, glm::vec3(-1.f, 2.5f, 6.f), -80.f, -8.f, 4.f, 1.4f });
+        path.add({ 8.f, glm::vec3(-4.f, 2.f, 2.f), -45.f, -5.f, 2.f, 2.8f });
+        path.add({ 12.f, glm::vec3(2.f, 3.f, 10.f), -95.f, -12.f, 12.f, 1.4f });
+        return path;
+    }
+
+    bool load(const std::string& file) {
+        std::ifstream stream(file);
+        if (!stream) {
+            std::cout << "Can't read the camera path " << file << "\n";
+            return false;
+        }
+        keyframes.clear();
+        std::string line;
+        while (std::getline(stream, line)) {
+            line = line.substr(0, line.find('#'));
+            if (line.find_first_not_of(" \t\r") == std::string::npos) { continue; }
+            std::istringstream values(line);
+            Keyframe k;
+            if (!(values >> k.time >> k.position.x >> k.position.y >> k.position.z
+                >> k.yaw >> k.pitch >> k.focusDistance >> k.aperture)) {
+                std::cout << "Invalid keyframe in " << file << ": " << line << "\n";
+                return false;
+            }
+            add(k);
+        }
+        return !keyframes.empty();
+    }
+
+    bool save(const std::string& file) const {
+        std::ofstream stream(file);
+        if (!stream) {
+            std::cout << "Can't write the camera path " << file << "\n";
+            return false;
+        }
+        stream << "# time x y z yaw pitch focusDistance aperture\n";
+        for (const Keyframe& k : keyframes) {
+            stream << k.time << " " << k.position.x << " " << k.position.y << " " << k.position.z << " "
+                << k.yaw << " " << k.pitch << " " << k.focusDistance << " " << k.aperture << "\n";
+        }
+        return true;
+    }
+
+    void add(const Keyframe& keyframe) {
+        auto it = keyframes.begin();
+        while (it != keyframes.end() && it->time <= keyframe.time) { it++; }
+        keyframes.insert(it, keyframe);
+    }
+
+    /**
+     * Records where the camera is right now
+     */
+    void add(float time, const Camera& camera) {
+        add({ time, camera.position, camera.yaw, camera.pitch, camera.focusDistance, camera.aperture });
+    }
+
+    void clear() { keyframes.clear(); }
+    size_t size() const { return keyframes.size(); }
+    float getDuration() const { return keyframes.empty() ? 0.f : keyframes.back().time; }
+
+    /**
+     * Moves the camera to where the path is at the given time, it stays at the ends outside of it
+     */
+    void apply(Camera& camera, float time) const {
+        if (keyframes.empty()) { return; }
+        size_t next = 0;
+        while (next < keyframes.size() && keyframes[next].time < time) { next++; }
+        const Keyframe& b = keyframes[next < keyframes.size() ? next : keyframes.size() - 1];
+        const Keyframe& a = keyframes[next > 0 ? next - 1 : 0];
+        const float span = b.time - a.time;
+        const float t = span > 0.f ? glm::clamp((time - a.time) / span, 0.f, 1.f) : 1.f;
+
+        camera.position = glm::mix(a.position, b.position, t);
+        camera.yaw = glm::mix(a.yaw, b.yaw, t);
+        camera.pitch = glm::mix(a.pitch, b.pitch, t);
+        camera.focusDistance = glm::mix(a.focusDistance, b.focusDistance, t);
+        camera.aperture = glm::mix(a.aperture, b.aperture, t);
+        camera.updateCameraVectors();
+    }
+};
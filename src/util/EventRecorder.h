@@ -0,0 +1,134 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+
+#include "Event.h"
+#include "Util.h"
+
+/**
+ * Binary recording of the events and frame times that went into Scene::update
+ * Header: "DOFE", version, width, height. Then every frame: float deltaTime, uint16 event count
+ * and per event uint8 type, float x, float y. Native byte order, so replay on the same architecture
+ * Settings changed in the UI aren't part of it, resizes are recorded but not replayed
+ */
+namespace EventFile {
+    const char MAGIC[4] = { 'D', 'O', 'F', 'E' };
+    const uint32_t VERSION = 1;
+}
+
+class EventRecorder {
+    std::ofstream file;
+    int frames = 0;
+
+    template <typename T>
+    void write(const T& value) {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+public:
+    NO_COPY(EventRecorder)
+
+    EventRecorder(const std::string& path, int width, int height) : file(path, std::ios::binary) {
+        if (!file) {
+            std::cout << "Can't record the events to " << path << "\n";
+            return;
+        }
+        file.write(EventFile::MAGIC, sizeof(EventFile::MAGIC));
+        write(EventFile::VERSION);
+        write(int32_t(width));
+        write(int32_t(height));
+    }
+
+    bool isValid() const { return bool(file); }
+    int getFrameCount() const { return frames; }
+
+    void record(const std::vector<Event>& events, float deltaTime) {
+        if (!file) { return; }
+        write(deltaTime);
+        write(uint16_t(events.size()));
+        for (const Event& e : events) {
+            write(uint8_t(e.type));
+            write(e.x);
+            write(e.y);
+        }
+        // About once a second, so a crash still leaves most of the session
+        if (++frames % 60 == 0) { file.flush(); }
+    }
+};
+
+class EventPlayer {
+    struct Frame {
+        float deltaTime;
+        std::vector<Event> events;
+    };
+    std::vector<Frame> frames;
+    size_t current = 0;
+    int width = 0, height = 0;
+
+    template <typename T>
+    static bool read(std::ifstream& file, T& value) {
+        return bool(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+public:
+    /**
+     * Reads the whole file up front, so replaying doesn't touch the disk
+     */
+    bool load(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        char magic[4];
+        uint32_t version = 0;
+        int32_t w = 0, h = 0;
+        if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, EventFile::MAGIC, sizeof(magic)) != 0 ||
+            !read(file, version) || version != EventFile::VERSION || !read(file, w) || !read(file, h)) {
+            std::cout << "Not an event recording: " << path << "\n";
+            return false;
+        }
+        width = w;
+        height = h;
+        frames.clear();
+        current = 0;
+
+        Frame frame;
+        uint16_t count = 0;
+        while (read(file, frame.deltaTime) && read(file, count)) {
+            frame.events.clear();
+            for (uint16_t i = 0; i < count; i++) {
+                uint8_t type = 0;
+                Event e;
+                if (!read(file, type) || !read(file, e.x) || !read(file, e.y)) { break; }
+                if (type >= Event::EVENTCOUNT) { continue; } // From a newer version
+                // The header has the size it started at, replays keep the size of their own target
+                if (type == Event::RESIZE) { continue; }
+                e.type = Event::Type(type);
+                frame.events.push_back(e);
+            }
+            frames.push_back(frame); // A cut off last frame still has its time
+        }
+        return true;
+    }
+
+    /**
+     * Adds the events of the next frame and sets its time, false once it's over
+     */
+    bool next(std::vector<Event>& events, float& deltaTime) {
+        if (current >= frames.size()) { return false; }
+        const Frame& frame = frames[current++];
+        events.insert(events.end(), frame.events.begin(), frame.events.end());
+        deltaTime = frame.deltaTime;
+        return true;
+    }
+
+    bool isDone() const { return current >= frames.size(); }
+    int getFrameCount() const { return int(frames.size()); }
+
+    /**
+     * Window size when the recording started
+     */
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+};
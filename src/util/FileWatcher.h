@@ -0,0 +1,112 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <algorithm>
+#include <sys/stat.h>
+
+#ifdef __linux__
+    #include <sys/inotify.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+#endif
+
+/**
+ * Calls a function when a file got written, poll() never blocks
+ * Uses inotify on Linux and compares modification times everywhere else
+ * Linux watches the directories, since a lot of editors save by replacing the file
+ */
+class FileWatcher {
+    struct Watch {
+        std::string path;
+        std::string directory;
+        std::string name;
+        long long modified = 0;
+        std::function<void()> onChange;
+    };
+    std::vector<Watch> watches;
+
+#ifdef __linux__
+    int fd = -1;
+    std::map<int, std::string> directories; // Watch descriptor to path
+#endif
+
+public:
+    FileWatcher() {
+#ifdef __linux__
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    }
+
+    ~FileWatcher() {
+#ifdef __linux__
+        if (fd >= 0) { close(fd); }
+#endif
+    }
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator= (const FileWatcher&) = delete;
+
+    void watch(const std::string& path, std::function<void()> onChange) {
+        Watch w;
+        w.path = path;
+        const size_t slash = path.find_last_of("/\\");
+        w.directory = slash == std::string::npos ? "." : path.substr(0, slash);
+        w.name = slash == std::string::npos ? path : path.substr(slash + 1);
+        w.modified = getModified(path);
+        w.onChange = std::move(onChange);
+
+#ifdef __linux__
+        if (fd >= 0) {
+            const int wd = inotify_add_watch(fd, w.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+            if (wd >= 0) { directories[wd] = w.directory; }
+        }
+#endif
+        watches.push_back(std::move(w));
+    }
+
+    void poll() {
+#ifdef __linux__
+        if (fd >= 0) {
+            alignas(inotify_event) char buffer[4096];
+            std::vector<size_t> changed; // Indices, onChange might add watches
+            for (;;) {
+                const ssize_t length = read(fd, buffer, sizeof(buffer));
+                if (length <= 0) { break; }
+                for (ssize_t i = 0; i < length;) {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + i);
+                    i += sizeof(inotify_event) + event->len;
+                    if (event->len == 0) { continue; }
+                    const std::string& directory = directories[event->wd];
+                    for (size_t w = 0; w < watches.size(); w++) {
+                        const bool match = watches[w].directory == directory && watches[w].name == event->name;
+                        // One save can come with a couple of events
+                        if (match && std::find(changed.begin(), changed.end(), w) == changed.end()) {
+                            changed.push_back(w);
+                        }
+                    }
+                }
+            }
+            for (size_t w : changed) {
+                watches[w].onChange();
+            }
+            return;
+        }
+#endif
+        for (size_t w = 0; w < watches.size(); w++) {
+            const long long modified = getModified(watches[w].path);
+            if (modified != watches[w].modified) {
+                watches[w].modified = modified;
+                watches[w].onChange();
+            }
+        }
+    }
+
+private:
+    static long long getModified(const std::string& path) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) { return 0; }
+        return static_cast<long long>(info.st_mtime);
+    }
+};
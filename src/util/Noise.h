@@ -0,0 +1,127 @@
+#pragma once
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+/**
+ * Tileable blue noise generated with the void and cluster method
+ * http://cv.ulichney.com/papers/1993-void-cluster.pdf
+ * Every value from 0 to 255 appears equally often, neighbours are as different as possible
+ * Takes a moment for bigger sizes, 64 is plenty for rotating sample kernels
+ */
+inline std::vector<unsigned char> generateBlueNoise(int size, unsigned int seed = 1) {
+    const int n = size * size;
+    const float sigma = 1.5f;
+
+    // Gaussian weight for every wrapped offset, so the pattern tiles
+    std::vector<float> gauss(n);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            const float dx = float(std::min(x, size - x));
+            const float dy = float(std::min(y, size - y));
+            gauss[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.f * sigma * sigma));
+        }
+    }
+
+    std::vector<float> energy(n, 0.f);
+    std::vector<bool> pattern(n, false);
+    std::vector<int> rank(n, 0);
+
+    const auto splat = [&](int i, float sign) {
+        pattern[i] = sign > 0.f;
+        const int ix = i % size, iy = i / size;
+        for (int y = 0; y < size; y++) {
+            const int row = ((y - iy + size) % size) * size;
+            for (int x = 0; x < size; x++) {
+                energy[y * size + x] += sign * gauss[row + (x - ix + size) % size];
+            }
+        }
+    };
+
+    // Densest point of the pattern or the emptiest spot outside of it
+    const auto find = [&](bool cluster) {
+        int best = -1;
+        for (int i = 0; i < n; i++) {
+            if (pattern[i] != cluster) { continue; }
+            if (best < 0 || (cluster ? energy[i] > energy[best] : energy[i] < energy[best])) {
+                best = i;
+            }
+        }
+        return best;
+    };
+
+    // Random initial pattern with a tenth of the points set
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(0, n - 1);
+    const int ones = std::max(1, n / 10);
+    for (int placed = 0; placed < ones;) {
+        const int i = dist(rng);
+        if (pattern[i]) { continue; }
+        splat(i, 1.f);
+        placed++;
+    }
+
+    // Move points from the tightest cluster into the largest void until it's stable
+    for (;;) {
+        const int cluster = find(true);
+        splat(cluster, -1.f);
+        const int hole = find(false);
+        splat(hole, 1.f);
+        if (hole == cluster) { break; }
+    }
+
+    const std::vector<bool> initialPattern = pattern;
+    const std::vector<float> initialEnergy = energy;
+
+    // Rank the initial points by removing the tightest clusters first
+    for (int r = ones - 1; r >= 0; r--) {
+        const int cluster = find(true);
+        splat(cluster, -1.f);
+        rank[cluster] = r;
+    }
+
+    // And the rest by filling the largest voids
+    pattern = initialPattern;
+    energy = initialEnergy;
+    for (int r = ones; r < n; r++) {
+        const int hole = find(false);
+        splat(hole, 1.f);
+        rank[hole] = r;
+    }
+
+    std::vector<unsigned char> noise(n);
+    for (int i = 0; i < n; i++) {
+        noise[i] = (unsigned char)(rank[i] * 256 / n);
+    }
+    return noise;
+}
+
+/**
+ * Tileable value noise for the film grain, random values on a lattice of cells x cells points
+ * with cellSize texels between them. The smoothstep in between is baked in, so linear filtering
+ * is all that's left when sampling
+ */
+inline std::vector<unsigned char> generateGrainNoise(int cells, int cellSize, unsigned int seed = 1) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(0.f, 1.f);
+    std::vector<float> lattice(cells * cells);
+    for (float& v : lattice) { v = dist(rng); }
+
+    const int size = cells * cellSize;
+    std::vector<unsigned char> noise(size * size);
+    for (int y = 0; y < size; y++) {
+        const int y0 = y / cellSize, y1 = (y0 + 1) % cells;
+        float fy = float(y % cellSize) / float(cellSize);
+        fy = fy * fy * (3.f - 2.f * fy);
+        for (int x = 0; x < size; x++) {
+            const int x0 = x / cellSize, x1 = (x0 + 1) % cells;
+            float fx = float(x % cellSize) / float(cellSize);
+            fx = fx * fx * (3.f - 2.f * fx);
+            const float top = lattice[y0 * cells + x0] * (1.f - fx) + lattice[y0 * cells + x1] * fx;
+            const float bottom = lattice[y1 * cells + x0] * (1.f - fx) + lattice[y1 * cells + x1] * fx;
+            noise[y * size + x] = (unsigned char)std::min(255.f, (top * (1.f - fy) + bottom * fy) * 256.f);
+        }
+    }
+    return noise;
+}
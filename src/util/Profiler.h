@@ -0,0 +1,122 @@
+#pragma once
+
+/**
+ * Scoped CPU timing, only compiled in with the CPU_PROFILER define (cmake -DCPU_PROFILER=ON)
+ * PROFILE_SCOPE("name") measures until the end of the block and needs a string literal
+ * Every thread writes into its own ring buffer without locking, exportChromeTrace()
+ * writes the last events of all threads for chrome://tracing or https://ui.perfetto.dev
+ */
+#ifdef CPU_PROFILER
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define PROFILE_CONCAT_INNER(a, b) a ## b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) CpuProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+class CpuProfiler {
+public:
+    static const size_t EVENTS = 1 << 16; // Per thread, the oldest get overwritten
+
+    struct Event {
+        const char* name;
+        long long start; // Microseconds since the start of the profiler
+        long long duration;
+    };
+
+    /**
+     * Only its own thread writes, the count is published after the event so readers see whole events
+     */
+    struct ThreadBuffer {
+        std::vector<Event> events = std::vector<Event>(EVENTS);
+        std::atomic<size_t> count{ 0 };
+        int thread = 0;
+    };
+
+private:
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    std::mutex mutex; // Only for adding threads
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+public:
+    long long now() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    ThreadBuffer& getThreadBuffer() {
+        thread_local std::shared_ptr<ThreadBuffer> buffer;
+        if (buffer == nullptr) {
+            buffer = std::make_shared<ThreadBuffer>();
+            std::lock_guard<std::mutex> lock(mutex);
+            buffer->thread = int(buffers.size());
+            buffers.push_back(buffer);
+        }
+        return *buffer;
+    }
+
+    void record(const char* name, long long start, long long end) {
+        ThreadBuffer& buffer = getThreadBuffer();
+        const size_t count = buffer.count.load(std::memory_order_relaxed);
+        buffer.events[count % EVENTS] = { name, start, end - start };
+        buffer.count.store(count + 1, std::memory_order_release);
+    }
+
+    /**
+     * Events of other threads that get overwritten while writing can come out mixed up,
+     * export from a quiet moment to be safe
+     */
+    bool exportChromeTrace(const std::string& path) {
+        std::ofstream file(path);
+        if (!file) {
+            std::cerr << "Can't write the CPU profile to " << path << "\n";
+            return false;
+        }
+        std::vector<std::shared_ptr<ThreadBuffer>> threads;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            threads = buffers;
+        }
+        file << "{\"traceEvents\":[\n";
+        bool first = true;
+        for (auto& buffer : threads) {
+            const size_t count = buffer->count.load(std::memory_order_acquire);
+            for (size_t i = count > EVENTS ? count - EVENTS : 0; i < count; i++) {
+                const Event& e = buffer->events[i % EVENTS];
+                file << (first ? "" : ",\n") << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+                    << buffer->thread << ",\"ts\":" << e.start << ",\"dur\":" << e.duration << "}";
+                first = false;
+            }
+        }
+        file << "\n]}\n";
+        return true;
+    }
+};
+
+inline CpuProfiler& getCpuProfiler() {
+    static CpuProfiler profiler;
+    return profiler;
+}
+
+class CpuProfileScope {
+    const char* name;
+    long long start;
+
+public:
+    explicit CpuProfileScope(const char* name) : name(name), start(getCpuProfiler().now()) {}
+    ~CpuProfileScope() { getCpuProfiler().record(name, start, getCpuProfiler().now()); }
+
+    CpuProfileScope(const CpuProfileScope&) = delete;
+    CpuProfileScope& operator= (const CpuProfileScope&) = delete;
+};
+
+#else
+
+#define PROFILE_SCOPE(name)
+
+#endif
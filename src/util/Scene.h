@@ -1,6 +1,7 @@
 #pragma once
 #include "Camera.h"
 #include "Event.h"
+#include "Profiler.h"
 
 #include <glm.hpp>
 #include <gtc/type_ptr.hpp>
@@ -13,8 +14,22 @@ protected:
 
     float time = 0.0;
 
+    /**
+     * Matrices of the last frame, to reproject the history of temporal effects
+     * Have to be updated by the scene at the end of draw()
+     */
+    glm::mat4 previousView = glm::mat4(1.f);
+    glm::mat4 previousProjection = glm::mat4(1.f);
+    unsigned int frame = 0; // Lets the noise change every frame
+
 public:
+    /**
+     * Used where nothing was rendered
+     */
+    glm::vec4 background = { 0.9f, 0.9f, 1.f, 1.f };
+
     Scene() { }
+    virtual ~Scene() { }
     
     virtual void draw() = 0;
 
@@ -28,6 +43,7 @@ public:
     virtual void debugUi() {}
 
     void update(std::vector<Event> &events, float deltaTime) {
+        PROFILE_SCOPE("Scene::update");
         time += deltaTime;
         camera.update(events, deltaTime);
         
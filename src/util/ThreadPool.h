@@ -0,0 +1,87 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+#include "Util.h"
+
+/**
+ * A couple of worker threads, tasks start in the order they're added but can finish in any order
+ * The destructor finishes everything that's still queued
+ */
+class ThreadPool {
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wake; // Workers wait for tasks
+    std::condition_variable idle; // wait() waits for the workers
+    int busy = 0;
+    bool stopping = false;
+
+public:
+    NO_COPY(ThreadPool)
+
+    explicit ThreadPool(unsigned count = std::max(1u, std::thread::hardware_concurrency() / 2)) {
+        for (unsigned i = 0; i < count; i++) {
+            workers.emplace_back([this]() { run(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) { worker.join(); }
+    }
+
+    void add(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+    /**
+     * Blocks until every task added so far is done
+     */
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return tasks.empty() && busy == 0; });
+    }
+
+    /**
+     * Tasks that are queued or running
+     */
+    size_t getPending() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return tasks.size() + size_t(busy);
+    }
+
+private:
+    void run() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty()) { return; } // Only when stopping
+                task = std::move(tasks.front());
+                tasks.pop_front();
+                busy++;
+            }
+            task();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busy--;
+            }
+            idle.notify_all();
+        }
+    }
+};
@@ -1,6 +1,12 @@
 #pragma once
 #include <string>
 
+#ifdef _WIN32
+    #include <direct.h>
+#else
+    #include <sys/stat.h>
+#endif
+
 /**
  * A macro to disable all kinds of implicit copy mechanisms
  */
@@ -26,6 +32,17 @@ inline std::string platformPath(std::string path) {
     return path;
 }
 
+/**
+ * Creates a directory if it doesn't exist yet, the parent has to exist
+ */
+inline void makeDirectory(const std::string& path) {
+    #ifdef _WIN32
+        _mkdir(path.c_str());
+    #else
+        mkdir(path.c_str(), 0755);
+    #endif
+}
+
 #ifndef M_PI
     #define M_PI 3.14159265358979323846
 #endif
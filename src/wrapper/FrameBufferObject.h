@@ -25,6 +25,8 @@ public:
         bool depth = false;
         bool multisample = false;
         bool zBuffer = false;
+        bool copyZBuffer = false;
+        bool stencil = false;
         void addCustom(const TextureConfig& c, int _w = 0, int _h = 0 ) {
             if (!_w) { _w = w; }
             if (!_h) { _h = h; }
@@ -33,6 +35,12 @@ public:
         void addRGB16F(std::string name, int _w = 0, int _h = 0, GLuint filter = GL_NEAREST) {
             addCustom({ name, GL_RGB16F, GL_RGB, GL_FLOAT, filter, filter }, _w, _h);
         }
+        void addRGBA16F(std::string name, int _w = 0, int _h = 0, GLuint filter = GL_NEAREST) {
+            addCustom({ name, GL_RGBA16F, GL_RGBA, GL_FLOAT, filter, filter }, _w, _h);
+        }
+        void addRGBA32F(std::string name, int _w = 0, int _h = 0, GLuint filter = GL_NEAREST) {
+            addCustom({ name, GL_RGBA32F, GL_RGBA, GL_FLOAT, filter, filter }, _w, _h);
+        }
         void addRGBA8(std::string name, int _w = 0, int _h = 0, GLuint filter = GL_NEAREST) {
             addCustom({ name, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, filter, filter }, _w, _h);
         }
@@ -42,14 +50,43 @@ public:
         void addR8(std::string name, int _w = 0, int _h = 0, GLuint filter = GL_NEAREST) {
             addCustom({ name, GL_RED, GL_RED, GL_UNSIGNED_BYTE, filter, filter }, _w, _h);
         }
+        void addRG16(std::string name, int _w = 0, int _h = 0, GLuint filter = GL_NEAREST) {
+            addCustom({ name, GL_RG16, GL_RG, GL_UNSIGNED_SHORT, filter, filter }, _w, _h);
+        }
+        void addRG8(std::string name, int _w = 0, int _h = 0, GLuint filter = GL_NEAREST) {
+            addCustom({ name, GL_RG8, GL_RG, GL_UNSIGNED_BYTE, filter, filter }, _w, _h);
+        }
+        void addRG16F(std::string name, int _w = 0, int _h = 0, GLuint filter = GL_NEAREST) {
+            addCustom({ name, GL_RG16F, GL_RG, GL_FLOAT, filter, filter }, _w, _h);
+        }
+        void addRG32UI(std::string name, int _w = 0, int _h = 0) {
+            addCustom({ name, GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT }, _w, _h);
+        }
+        void addR32F(std::string name, int _w = 0, int _h = 0, GLuint filter = GL_NEAREST) {
+            addCustom({ name, GL_R32F, GL_RED, GL_FLOAT, filter, filter }, _w, _h);
+        }
         void addR16F(std::string name, int _w = 0, int _h = 0, GLuint filter = GL_NEAREST) {
             addCustom({ name, GL_R16F, GL_RED, GL_FLOAT, filter, filter }, _w, _h);
         }
-        void addZBuffer() {
+        /**
+         * Adds a depth texture which can be sampled in later passes.
+         * By default it's attached directly as the depth attachment, so there is no
+         * renderbuffer and no copy. With copy set, the z-buffer is rendered into a
+         * renderbuffer and copied over to the texture after each draw instead
+         */
+        void addZBuffer(std::string name = "zBuffer", bool copy = false) {
             depth = true;
             if (zBuffer) { return; }
             zBuffer = true;
-            addCustom({ "zBuffer", GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT });
+            copyZBuffer = copy;
+            addCustom({ name, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT });
+        }
+        /**
+         * Adds a stencil buffer without a depth buffer, so the depth test doesn't get in the way
+         * With depth set it shares the depth renderbuffer instead, like the one of a window
+         */
+        void addStencil() {
+            stencil = true;
         }
     };
 
@@ -61,7 +98,14 @@ private:
     float scale = 1.0;
     GLuint fbId = 0, depthId = 0;
 
-    GLuint depthTexture = 0;
+    GLuint depthTexture = 0; // Only set if the z-buffer needs to be copied over
+    bool hasDepth = false;
+    bool hasStencil = false;
+
+    /**
+     * Draw buffers of integer textures, glClear doesn't work for them
+     */
+    std::vector<GLint> integerBuffers;
 
     /**
      * Textures a shader can write into
@@ -77,37 +121,68 @@ public:
         cleanUp();
     }
 
+    /**
+     * The framebuffer that stands in for the window, 0 unless rendering headless
+     * The passes fall back to it after drawing into their own FBOs
+     */
+    static GLuint& screen() {
+        static GLuint id = 0;
+        return id;
+    }
+
+    /**
+     * The viewport of the screen, draw() goes back to it without asking GL for the old one
+     * Whoever resizes the screen sets it through setScreenViewport()
+     */
+    struct Viewport {
+        int width = 0, height = 0;
+    };
+    static Viewport& screenViewport() {
+        static Viewport viewport;
+        return viewport;
+    }
+
+    static void setScreenViewport(int w, int h) {
+        screenViewport() = { w, h };
+        GLC(glViewport(0, 0, w, h));
+    }
+
     /**
      * Will bind/unbind the FBO and render call the provided function at the right time
      */
     void draw(const std::function<void()> &f) const {
         GLC(glBindFramebuffer(GL_FRAMEBUFFER, fbId));
         
-        if (depthId != 0) {
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (hasDepth) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | (hasStencil ? GL_STENCIL_BUFFER_BIT : 0));
             glEnable(GL_DEPTH_TEST);
+        } else if (hasStencil) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
         } else {
             glClear(GL_COLOR_BUFFER_BIT);
         }
 
-        if (scaledWidth != width) { // scale the viewport down if needed
-            GLC(glViewport(0, 0, scaledWidth, scaledHeight));
+        for (auto& i : integerBuffers) {
+            const GLuint zero[4] = { 0, 0, 0, 0 };
+            GLC(glClearBufferuiv(GL_COLOR, i, zero));
         }
+
+        // The FBO might not match the screen or be scaled, so use its own viewport
+        GLC(glViewport(0, 0, scaledWidth, scaledHeight));
         
         f(); // Render
         
         if (depthTexture != 0) {
             // If we have a depth texture, copy the current zbuffer over to a texture
+            // The storage is already allocated, so only the contents are replaced
             GLC(glBindTexture(GL_TEXTURE_2D, depthTexture));
-            GLC(glCopyTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, 0, 0, scaledWidth, scaledHeight, 0));
+            GLC(glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, scaledWidth, scaledHeight));
             GLC(glBindTexture(GL_TEXTURE_2D, 0));
         }
         
-        GLC(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+        GLC(glBindFramebuffer(GL_FRAMEBUFFER, screen()));
 
-        if (scaledWidth != width) { // scale it back up again
-            GLC(glViewport(0, 0, width, height));
-        }
+        GLC(glViewport(0, 0, screenViewport().width, screenViewport().height)); // and restore the screen's
         
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     }
@@ -138,13 +213,21 @@ public:
             std::shared_ptr<Texture> tex(new Texture(i.w, i.h, i.tex));
             
             if (i.tex.format == GL_DEPTH_COMPONENT) {
-                // The depth texture doesn't need to be registered to the fbo, since the shader doesn't write into it
-                depthTexture = tex->getId();
+                if (c.copyZBuffer) {
+                    // The depth texture doesn't need to be registered to the fbo, since the shader doesn't write into it
+                    depthTexture = tex->getId();
+                } else {
+                    // Render the depth straight into the texture
+                    GLC(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, i.tex.target, tex->getId(), 0));
+                }
             } else {
                 // The other texture will be accessible from the fragment shader as outputs
                 GLuint attachmentId = GL_COLOR_ATTACHMENT0 + index;
                 GLC(glFramebufferTexture2D(GL_FRAMEBUFFER, attachmentId, i.tex.target, tex->getId(), 0));
                 attach.push_back(attachmentId);
+                if (tex->isInteger()) {
+                    integerBuffers.push_back(index);
+                }
                 index++;
             }
             textures.push_back(tex);
@@ -153,20 +236,34 @@ public:
         // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering 
         GLC(glDrawBuffers(attach.size(), attach.data()));
 
-        if (c.depth) { // add the rbo if  needed
+        hasDepth = c.depth;
+
+        if (c.depth && (!c.zBuffer || c.copyZBuffer)) { // add the rbo if  needed
+            const GLenum format = c.stencil ? GL_DEPTH24_STENCIL8 : GL_DEPTH_COMPONENT;
             GLC(glGenRenderbuffers(1, &depthId));
             GLC(glBindRenderbuffer(GL_RENDERBUFFER, depthId));
             if (c.multisample) {
                 // TODO This might be wrong
-                GLC(glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_DEPTH_COMPONENT, scaledWidth, scaledHeight));
+                GLC(glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, format, scaledWidth, scaledHeight));
             } else {
-                GLC(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, scaledWidth, scaledHeight));
+                GLC(glRenderbufferStorage(GL_RENDERBUFFER, format, scaledWidth, scaledHeight));
             }
             glBindRenderbuffer(GL_RENDERBUFFER, 0);
-            GLC(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthId));
+            GLC(glFramebufferRenderbuffer(
+                GL_FRAMEBUFFER, c.stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthId
+            ));
+            hasStencil = c.stencil;
+        } else if (c.stencil) {
+            assert(!c.depth); // The z-buffer texture has no stencil
+            GLC(glGenRenderbuffers(1, &depthId));
+            GLC(glBindRenderbuffer(GL_RENDERBUFFER, depthId));
+            GLC(glRenderbufferStorage(GL_RENDERBUFFER, GL_STENCIL_INDEX8, scaledWidth, scaledHeight));
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+            GLC(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthId));
+            hasStencil = true;
         }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, screen());
     }
 
     Textures getTextures(Textures tex) {
@@ -182,6 +279,14 @@ public:
         return textures;
     }
 
+    /**
+     * The size of the textures after scaling
+     */
+    int getWidth() const { return scaledWidth; }
+    int getHeight() const { return scaledHeight; }
+
+    GLuint getId() const { return fbId; }
+
 private:
     void cleanUp() {
         textures.clear();
@@ -195,5 +300,8 @@ private:
             depthId = 0;
         }
         depthTexture = 0;
+        hasDepth = false;
+        hasStencil = false;
+        integerBuffers.clear();
     }
 };
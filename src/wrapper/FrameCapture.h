@@ -0,0 +1,229 @@
+#pragma once
+#include "glad/glad.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <iostream>
+#include <cstring>
+
+#include "Texture.h"
+#include "../util/Util.h"
+#include "../util/ThreadPool.h"
+
+// The implementations are in main.cpp
+#include <stb_image_write.h>
+#include <tinyexr.h>
+
+/**
+ * Writes framebuffers and textures to png or exr (picked by the extension) without waiting on the GPU
+ * The pixels are copied into a ring of pixel buffers, a fence tells when the copy is done.
+ * update() maps the finished ones and hands them to worker threads for encoding.
+ * Only if all SLOTS buffers are still in flight a capture has to wait for the oldest one
+ * Call finish() before the context goes away, nothing is written otherwise
+ */
+class FrameCapture {
+public:
+    static const int SLOTS = 4;
+
+private:
+    struct Slot {
+        GLuint pbo = 0;
+        size_t capacity = 0;
+        GLsync fence = nullptr;
+        std::string path;
+        int width = 0, height = 0, components = 0;
+        bool exr = false;
+    };
+    Slot slots[SLOTS];
+    int next = 0; // The oldest slot, gets reused next
+
+    std::atomic<int> written{ 0 };
+    // Started by the first capture, so there are no idle threads if nothing gets captured
+    // Last, so its threads are joined before anything they use goes away
+    std::unique_ptr<ThreadPool> encoders;
+
+public:
+    NO_COPY(FrameCapture)
+    FrameCapture() = default;
+
+    /**
+     * Color attachment 0 of a framebuffer, 0 is the back buffer of the window
+     */
+    void captureFramebuffer(GLuint framebuffer, int width, int height, const std::string& path) {
+        Slot& slot = begin(path, width, height, 3);
+        GLint previous = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous);
+        GLC(glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer));
+        GLC(glReadPixels(0, 0, width, height, GL_RGB, slot.exr ? GL_FLOAT : GL_UNSIGNED_BYTE, nullptr));
+        GLC(glBindFramebuffer(GL_READ_FRAMEBUFFER, GLuint(previous)));
+        end(slot);
+    }
+
+    /**
+     * Any texture that isn't an integer one, depth included. Two channels get an empty third
+     * Alpha only goes into exr files, it's mostly unused and would hide the png
+     */
+    void captureTexture(Texture& texture, const std::string& path) {
+        const TextureConfig& config = texture.getConfig();
+        if (texture.isInteger() || config.target != GL_TEXTURE_2D) {
+            std::cout << "Can't capture " << texture.getName() << ", only float and normalized 2D textures\n";
+            return;
+        }
+        GLenum format = GL_RGB;
+        int components = 3;
+        if (config.format == GL_RED || config.format == GL_DEPTH_COMPONENT) {
+            format = config.format;
+            components = 1;
+        } else if (config.format == GL_RGBA && isExr(path)) {
+            format = GL_RGBA;
+            components = 4;
+        }
+        Slot& slot = begin(path, texture.getWidth(), texture.getHeight(), components);
+        texture.use();
+        GLC(glGetTexImage(GL_TEXTURE_2D, 0, format, slot.exr ? GL_FLOAT : GL_UNSIGNED_BYTE, nullptr));
+        GLC(glBindTexture(GL_TEXTURE_2D, 0));
+        end(slot);
+    }
+
+    /**
+     * Call once per frame, never blocks
+     */
+    void update() {
+        for (int i = 0; i < SLOTS; i++) {
+            Slot& slot = slots[(next + i) % SLOTS];
+            if (slot.fence == nullptr) { continue; }
+            if (!retire(slot, false)) { break; } // Hands them out in the order they were captured
+        }
+    }
+
+    /**
+     * Waits until everything captured so far is on the disk
+     */
+    void finish() {
+        for (int i = 0; i < SLOTS; i++) {
+            Slot& slot = slots[(next + i) % SLOTS];
+            if (slot.fence != nullptr) { retire(slot, true); }
+        }
+        if (encoders != nullptr) { encoders->wait(); }
+    }
+
+    /**
+     * Captures that aren't written yet
+     */
+    int getPending() {
+        int pending = encoders != nullptr ? int(encoders->getPending()) : 0;
+        for (const Slot& slot : slots) {
+            if (slot.fence != nullptr) { pending++; }
+        }
+        return pending;
+    }
+
+    int getWritten() const { return written; }
+
+private:
+    Slot& begin(const std::string& path, int width, int height, int components) {
+        Slot& slot = slots[next];
+        next = (next + 1) % SLOTS;
+        if (slot.fence != nullptr) { retire(slot, true); }
+
+        slot.path = path;
+        slot.exr = isExr(path);
+        slot.width = width;
+        slot.height = height;
+        slot.components = components;
+
+        const size_t size = size_t(width) * height * components * (slot.exr ? sizeof(float) : 1);
+        if (slot.pbo == 0) { GLC(glGenBuffers(1, &slot.pbo)); }
+        GLC(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo));
+        if (size > slot.capacity) {
+            GLC(glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ));
+            slot.capacity = size;
+        }
+        GLC(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+        return slot;
+    }
+
+    void end(Slot& slot) {
+        GLC(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    /**
+     * Copies the pixels out of a finished slot and queues the encoding, false if it's not done yet
+     */
+    bool retire(Slot& slot, bool wait) {
+        const GLuint64 timeout = wait ? GLuint64(1000000000) : 0; // A second
+        GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        while (wait && status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        }
+        if (status == GL_TIMEOUT_EXPIRED) { return false; }
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        const size_t size = size_t(slot.width) * slot.height * slot.components * (slot.exr ? sizeof(float) : 1);
+        std::shared_ptr<std::vector<unsigned char>> pixels(new std::vector<unsigned char>(size));
+        GLC(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo));
+        const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+        if (mapped != nullptr) {
+            std::memcpy(pixels->data(), mapped, size);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        GLC(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+        if (mapped == nullptr) {
+            std::cout << "Failed to map the pixels of " << slot.path << "\n";
+            return true;
+        }
+
+        const std::string path = slot.path;
+        const int width = slot.width, height = slot.height, components = slot.components;
+        const bool exr = slot.exr;
+        if (encoders == nullptr) { encoders.reset(new ThreadPool()); }
+        encoders->add([this, pixels, path, width, height, components, exr]() {
+            if (encode(*pixels, path, width, height, components, exr)) { written++; }
+        });
+        return true;
+    }
+
+    static bool isExr(const std::string& path) {
+        return path.size() > 4 && path.compare(path.size() - 4, 4, ".exr") == 0;
+    }
+
+    static bool encode(
+        std::vector<unsigned char>& pixels, const std::string& path,
+        int width, int height, int components, bool exr
+    ) {
+        // GL starts at the bottom, stbi_flip_vertically_on_write() is global so flip here
+        const size_t row = pixels.size() / size_t(height);
+        std::vector<unsigned char> swap(row);
+        for (int y = 0; y < height / 2; y++) {
+            unsigned char* a = pixels.data() + row * y;
+            unsigned char* b = pixels.data() + row * (height - 1 - y);
+            std::memcpy(swap.data(), a, row);
+            std::memcpy(a, b, row);
+            std::memcpy(b, swap.data(), row);
+        }
+
+        if (!exr) {
+            if (!stbi_write_png(path.c_str(), width, height, components, pixels.data(), width * components)) {
+                std::cout << "Can't write " << path << "\n";
+                return false;
+            }
+            return true;
+        }
+        const char* error = nullptr;
+        const float* data = reinterpret_cast<const float*>(pixels.data());
+        if (SaveEXR(data, width, height, components, 1, path.c_str(), &error) != TINYEXR_SUCCESS) {
+            std::cout << "Can't write " << path << ": " << (error ? error : "") << "\n";
+            if (error != nullptr) { FreeEXRErrorMessage(error); }
+            return false;
+        }
+        return true;
+    }
+};
+
+inline FrameCapture& getFrameCapture() {
+    static FrameCapture capture;
+    return capture;
+}
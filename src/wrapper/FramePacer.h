@@ -0,0 +1,97 @@
+#pragma once
+#include "glad/glad.h"
+#include <chrono>
+#include <algorithm>
+#include "../util/Util.h"
+
+/**
+ * Limits how many frames the CPU can record ahead of the GPU with a fence per frame
+ * With one frame in flight the CPU waits until the GPU finished the last frame before it reads
+ * the input, which gives the lowest latency. More frames let the CPU work on the next frame
+ * while the GPU still renders, which evens out the frame times at the cost of a frame of latency each
+ * Frames the GPU is known to be done with can have their per frame resources overwritten without syncing
+ */
+class FramePacer {
+public:
+    static const int MAX_FRAMES = 3;
+
+    enum Mode {
+        LATENCY = 0,
+        THROUGHPUT
+    };
+
+private:
+    GLsync fences[MAX_FRAMES] = {};
+    long long fenceFrames[MAX_FRAMES] = {}; // Which frame each fence belongs to
+    long long frame = 0;
+    long long completed = -1;
+    bool running = false;
+    float waitMs = 0.f;
+
+public:
+    NO_COPY(FramePacer)
+    FramePacer() = default;
+
+    Mode mode = THROUGHPUT;
+    int throughputFrames = 2; // Frames in flight in the throughput mode
+
+    int getFramesInFlight() const {
+        return mode == LATENCY ? 1 : clamp(throughputFrames, 1, MAX_FRAMES);
+    }
+
+    /**
+     * Call at the very start of a frame, before the input is read
+     */
+    void beginFrame() {
+        running = true;
+        const auto start = std::chrono::steady_clock::now();
+        const long long allowed = frame - getFramesInFlight(); // This frame and older have to be done
+        for (int i = 0; i < MAX_FRAMES; i++) {
+            if (fences[i] == nullptr) { continue; }
+            const bool wait = fenceFrames[i] <= allowed;
+            GLenum status = glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            while (wait && status == GL_TIMEOUT_EXPIRED) {
+                status = glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000));
+            }
+            if (status != GL_TIMEOUT_EXPIRED) {
+                completed = std::max(completed, fenceFrames[i]);
+                glDeleteSync(fences[i]);
+                fences[i] = nullptr;
+            }
+        }
+        waitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * Call after the swap, so the fence comes after every command of the frame
+     */
+    void endFrame() {
+        const int slot = int(frame % MAX_FRAMES);
+        if (fences[slot] != nullptr) { glDeleteSync(fences[slot]); } // Only if nobody waited for it
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        fenceFrames[slot] = frame;
+        frame++;
+    }
+
+    /**
+     * False until beginFrame() is called, without it nothing is known to be done
+     */
+    bool isRunning() const { return running; }
+
+    long long getFrame() const { return frame; }
+
+    /**
+     * The newest frame the GPU is done with, everything it used can be overwritten
+     */
+    long long getCompletedFrame() const { return completed; }
+
+    /**
+     * How long the CPU waited for the GPU in the last beginFrame()
+     */
+    float getWaitMs() const { return waitMs; }
+};
+
+inline FramePacer& getFramePacer() {
+    static FramePacer pacer;
+    return pacer;
+}
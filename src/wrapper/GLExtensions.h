@@ -0,0 +1,86 @@
+#pragma once
+#include "glad/glad.h"
+#include <string>
+#include <cstring>
+
+/**
+ * glad only loads plain OpenGL 3.3, the few newer functions used here are loaded by hand
+ * Everything is optional, check the flags before using them
+ */
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    #define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+    #define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+    #define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_PROGRAM_BINARY_FORMATS
+    #define GL_PROGRAM_BINARY_FORMATS 0x87FF
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+    #define GL_COMPLETION_STATUS_KHR 0x91B1 // Same value for the ARB version
+#endif
+
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYEXTPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYEXTPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIEXTPROC)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSEXTPROC)(GLuint count);
+
+struct GLExtensions {
+    // ARB_get_program_binary, core since 4.1
+    bool hasProgramBinary = false;
+    PFNGLGETPROGRAMBINARYEXTPROC getProgramBinary = nullptr;
+    PFNGLPROGRAMBINARYEXTPROC programBinary = nullptr;
+    PFNGLPROGRAMPARAMETERIEXTPROC programParameteri = nullptr;
+
+    // KHR_parallel_shader_compile or its ARB twin, compiles in the background
+    bool hasParallelCompile = false;
+    PFNGLMAXSHADERCOMPILERTHREADSEXTPROC maxShaderCompilerThreads = nullptr;
+};
+
+inline GLExtensions& getGLExtensions() {
+    static GLExtensions extensions;
+    return extensions;
+}
+
+inline bool hasGLExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, GLuint(i)));
+        if (extension != nullptr && std::strcmp(extension, name) == 0) { return true; }
+    }
+    return false;
+}
+
+/**
+ * Call once after gladLoadGL() with the same loader, e.g. glfwGetProcAddress
+ */
+inline void loadGLExtensions(GLADloadproc load) {
+    GLExtensions& ext = getGLExtensions();
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+    if (major * 10 + minor >= 41 || hasGLExtension("GL_ARB_get_program_binary")) {
+        ext.getProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYEXTPROC>(load("glGetProgramBinary"));
+        ext.programBinary = reinterpret_cast<PFNGLPROGRAMBINARYEXTPROC>(load("glProgramBinary"));
+        ext.programParameteri = reinterpret_cast<PFNGLPROGRAMPARAMETERIEXTPROC>(load("glProgramParameteri"));
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        // Without any format the driver can't give us binaries, even if the functions are there
+        ext.hasProgramBinary = ext.getProgramBinary && ext.programBinary && ext.programParameteri && formats > 0;
+    }
+
+    if (hasGLExtension("GL_KHR_parallel_shader_compile")) {
+        ext.maxShaderCompilerThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSEXTPROC>(load("glMaxShaderCompilerThreadsKHR"));
+    } else if (hasGLExtension("GL_ARB_parallel_shader_compile")) {
+        ext.maxShaderCompilerThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSEXTPROC>(load("glMaxShaderCompilerThreadsARB"));
+    }
+    if (ext.maxShaderCompilerThreads != nullptr) {
+        ext.maxShaderCompilerThreads(0xFFFFFFFF); // As many threads as the driver likes
+        ext.hasParallelCompile = true;
+    }
+}
@@ -0,0 +1,178 @@
+#pragma once
+#include "glad/glad.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cassert>
+#include "../util/Util.h"
+
+/**
+ * GPU time of every pass of a frame with timestamp queries
+ * mark() starts a pass that lasts until the next mark or the end of the frame,
+ * so the passes just follow each other. Unlike GpuTimer this works inside a GpuTimer::measure()
+ * The results are read FRAMES frames later, if they're still not there the frame isn't recorded
+ */
+class GpuProfiler {
+public:
+    static const int FRAMES = 3;
+    static const int HISTORY = 256;
+
+private:
+    struct Frame {
+        std::vector<GLuint> queries;
+        std::vector<int> sections; // Section of every query, -1 ends the frame
+        size_t used = 0;
+        bool pending = false;
+    };
+    Frame frames[FRAMES];
+    int current = 0;
+    bool recording = false;
+
+    std::vector<std::string> names;
+    std::vector<std::vector<float>> history; // Ring buffer of milliseconds for every section
+    std::vector<float> totals;
+    int recorded = 0;
+
+public:
+    NO_COPY(GpuProfiler)
+    GpuProfiler() : totals(HISTORY, 0.f) {}
+
+    bool enabled = true;
+
+    void beginFrame() {
+        collect();
+        recording = enabled && !frames[current].pending;
+        if (recording) {
+            frames[current].used = 0;
+        }
+    }
+
+    void mark(const std::string& name) {
+        if (!recording) { return; }
+        int section = 0;
+        while (section < int(names.size()) && names[section] != name) { section++; }
+        if (section == int(names.size())) {
+            names.push_back(name);
+            history.push_back(std::vector<float>(HISTORY, 0.f));
+        }
+        addQuery(section);
+    }
+
+    void endFrame() {
+        if (!recording) { return; }
+        addQuery(-1);
+        frames[current].pending = true;
+        current = (current + 1) % FRAMES;
+        recording = false;
+    }
+
+    int getSectionCount() const { return int(names.size()); }
+    const std::string& getName(int section) const { return names[section]; }
+    int getRecordedFrames() const { return recorded < HISTORY ? recorded : HISTORY; }
+
+    /**
+     * Every frame recorded so far, only the last HISTORY ones can still be read with getValue()
+     */
+    int getTotalFrames() const { return recorded; }
+
+    /**
+     * Milliseconds of a section in the given recorded frame. -1 for the whole frame
+     */
+    float getValue(int section, int frame) const {
+        assert(frame < recorded && frame >= recorded - HISTORY);
+        return (section < 0 ? totals : history[section])[frame % HISTORY];
+    }
+
+    /**
+     * Waits for the GPU and reads everything still in flight, e.g. before looking at the results
+     */
+    void finish() {
+        glFinish();
+        collect();
+    }
+
+    /**
+     * Milliseconds of the last recorded frames, oldest first. -1 for the whole frame
+     */
+    std::vector<float> getHistory(int section) const {
+        const std::vector<float>& values = section < 0 ? totals : history[section];
+        std::vector<float> ordered;
+        const int count = getRecordedFrames();
+        for (int i = recorded - count; i < recorded; i++) {
+            ordered.push_back(values[i % HISTORY]);
+        }
+        return ordered;
+    }
+
+    float getAverage(int section) const {
+        const std::vector<float> values = getHistory(section);
+        float sum = 0.f;
+        for (float v : values) { sum += v; }
+        return values.empty() ? 0.f : sum / float(values.size());
+    }
+
+    /**
+     * One line per recorded frame and a column per pass, in milliseconds
+     */
+    bool exportCsv(const std::string& path) const {
+        std::ofstream file(path);
+        if (!file) {
+            std::cerr << "Can't write the GPU profile to " << path << "\n";
+            return false;
+        }
+        file << "frame";
+        for (const std::string& name : names) { file << "," << name; }
+        file << ",total\n";
+        const int count = getRecordedFrames();
+        for (int i = recorded - count; i < recorded; i++) {
+            file << i;
+            for (const std::vector<float>& values : history) { file << "," << values[i % HISTORY]; }
+            file << "," << totals[i % HISTORY] << "\n";
+        }
+        return true;
+    }
+
+private:
+    void addQuery(int section) {
+        Frame& frame = frames[current];
+        if (frame.used == frame.queries.size()) {
+            GLuint query = 0;
+            GLC(glGenQueries(1, &query));
+            frame.queries.push_back(query);
+            frame.sections.push_back(section);
+        }
+        frame.sections[frame.used] = section;
+        GLC(glQueryCounter(frame.queries[frame.used], GL_TIMESTAMP));
+        frame.used++;
+    }
+
+    void collect() {
+        for (int i = 0; i < FRAMES; i++) {
+            Frame& frame = frames[(current + i) % FRAMES]; // Oldest first
+            if (!frame.pending) { continue; }
+            GLint available = 0;
+            glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) { break; }
+
+            std::vector<GLuint64> stamps(frame.used);
+            for (size_t q = 0; q < frame.used; q++) {
+                glGetQueryObjectui64v(frame.queries[q], GL_QUERY_RESULT, &stamps[q]);
+            }
+            const int slot = recorded % HISTORY;
+            for (std::vector<float>& values : history) { values[slot] = 0.f; }
+            for (size_t q = 0; q + 1 < frame.used; q++) {
+                // A pass that shows up twice in a frame is summed up
+                history[frame.sections[q]][slot] += float(stamps[q + 1] - stamps[q]) / 1e6f;
+            }
+            totals[slot] = float(stamps[frame.used - 1] - stamps[0]) / 1e6f;
+            recorded++;
+            frame.pending = false;
+        }
+    }
+};
+
+inline GpuProfiler& getGpuProfiler() {
+    static GpuProfiler profiler;
+    return profiler;
+}
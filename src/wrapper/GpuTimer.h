@@ -0,0 +1,65 @@
+#pragma once
+#include "glad/glad.h"
+#include <functional>
+#include "../util/Util.h"
+
+/**
+ * Measures how long the GPU takes for a couple of draw calls
+ * The results are read a few frames later, so it never waits on the GPU
+ * Time elapsed queries can't be nested, so only one timer can measure at a time
+ */
+class GpuTimer {
+    static const int QUERIES = 4;
+    GLuint queries[QUERIES] = {};
+    bool pending[QUERIES] = {};
+    int current = 0;
+    float ms = 0.f;
+
+public:
+    NO_COPY(GpuTimer)
+
+    GpuTimer() {
+        GLC(glGenQueries(QUERIES, queries));
+    }
+
+    ~GpuTimer() {
+        GLC(glDeleteQueries(QUERIES, queries));
+    }
+
+    /**
+     * Runs f and measures it, if all queries are still in flight it's just run
+     */
+    void measure(const std::function<void()>& f) {
+        collect();
+        if (pending[current]) {
+            f();
+            return;
+        }
+        GLC(glBeginQuery(GL_TIME_ELAPSED, queries[current]));
+        f();
+        GLC(glEndQuery(GL_TIME_ELAPSED));
+        pending[current] = true;
+        current = (current + 1) % QUERIES;
+    }
+
+    /**
+     * Smoothed time in milliseconds
+     */
+    float getMs() const { return ms; }
+
+private:
+    void collect() {
+        for (int i = 0; i < QUERIES; i++) {
+            const int q = (current + i) % QUERIES; // Oldest first
+            if (!pending[q]) { continue; }
+            GLint available = 0;
+            glGetQueryObjectiv(queries[q], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) { break; }
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(queries[q], GL_QUERY_RESULT, &ns);
+            const float t = float(ns) / 1e6f;
+            ms = ms == 0.f ? t : ms * 0.9f + t * 0.1f;
+            pending[q] = false;
+        }
+    }
+};
@@ -0,0 +1,116 @@
+#pragma once
+#include "glad/glad.h"
+#include <string>
+#include <iostream>
+
+#include "FrameBufferObject.h"
+#include "../util/Util.h"
+
+#ifdef HEADLESS_EGL
+    #include <EGL/egl.h>
+    #include <EGL/eglext.h>
+#endif
+
+#ifdef HEADLESS_EGL
+/**
+ * OpenGL 3.3 core context without any window or display, built with -DHEADLESS_EGL=ON
+ * Uses Mesa's surfaceless platform if it's there, so it also runs on render nodes and llvmpipe
+ * There is no default framebuffer, everything has to go into an OffscreenTarget
+ */
+class EglContext {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+
+public:
+    NO_COPY(EglContext)
+
+    EglContext() {
+        const auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT")
+        );
+        if (getPlatformDisplay != nullptr) {
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+        if (display == EGL_NO_DISPLAY) {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+            std::cout << "Failed to initialize EGL\n";
+            display = EGL_NO_DISPLAY;
+            return;
+        }
+        eglBindAPI(EGL_OPENGL_API);
+
+        const EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE
+        };
+        EGLConfig config;
+        EGLint count = 0;
+        if (!eglChooseConfig(display, configAttributes, &config, 1, &count) || count == 0) {
+            std::cout << "No EGL config for OpenGL\n";
+            return;
+        }
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE
+        };
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+        if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+            std::cout << "Failed to create a surfaceless EGL context\n";
+            context = EGL_NO_CONTEXT;
+        }
+    }
+
+    ~EglContext() {
+        if (display == EGL_NO_DISPLAY) { return; }
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context != EGL_NO_CONTEXT) { eglDestroyContext(display, context); }
+        eglTerminate(display);
+    }
+
+    bool isValid() const { return context != EGL_NO_CONTEXT; }
+
+    static void* getProcAddress(const char* name) {
+        return reinterpret_cast<void*>(eglGetProcAddress(name));
+    }
+};
+#endif
+
+/**
+ * Color and depth at a fixed size that replaces the window when rendering headless
+ * bind() makes it the screen, so the last pass of a scene ends up in here
+ */
+class OffscreenTarget {
+    FrameBufferObject fbo;
+    int width, height;
+
+public:
+    NO_COPY(OffscreenTarget)
+
+    OffscreenTarget(int width, int height) : fbo([](FrameBufferObject::FrameBufferConfig& c) {
+        c.addRGBA8("color");
+        c.depth = true; // Depth and stencil renderbuffer like a window has
+        c.addStencil();
+    }), width(width), height(height) {
+        fbo.resize(width, height);
+    }
+
+    ~OffscreenTarget() {
+        if (FrameBufferObject::screen() == fbo.getId()) {
+            FrameBufferObject::screen() = 0;
+        }
+    }
+
+    void bind() const {
+        FrameBufferObject::screen() = fbo.getId();
+        GLC(glBindFramebuffer(GL_FRAMEBUFFER, fbo.getId()));
+        FrameBufferObject::setScreenViewport(width, height);
+    }
+
+    /**
+     * To read it back, e.g. with FrameCapture
+     */
+    GLuint getId() const { return fbo.getId(); }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+};
@@ -18,6 +18,7 @@
 #include "Shader.h"
 #include "Texture.h"
 #include "Mesh.h"
+#include "../util/Profiler.h"
 #include "../util/Util.h"
 #include <set>
 
@@ -46,6 +47,7 @@ public:
     
 private:
     void loadModel(std::string const &path) {
+        PROFILE_SCOPE("Model::loadModel");
         tinyobj::attrib_t attrib;
         std::vector<tinyobj::shape_t> shapes;
         std::vector<tinyobj::material_t> tinyMaterials;
@@ -0,0 +1,128 @@
+#pragma once
+#include "glad/glad.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+#include "GLExtensions.h"
+#include "../util/Util.h"
+
+/**
+ * Keeps linked programs on disk, so the next start doesn't compile them again
+ * The key hashes the sources and the driver, so a driver update just compiles everything once more
+ * Anything the driver rejects falls back to compiling from source, which then replaces the file
+ */
+class ProgramCache {
+    std::string directory = platformPath("shadercache/");
+    std::string driver;
+    std::vector<GLint> formats;
+    bool initialized = false;
+    int loaded = 0, compiled = 0;
+
+public:
+    NO_COPY(ProgramCache)
+    ProgramCache() = default;
+
+    bool enabled = true;
+
+    bool isSupported() {
+        init();
+        return getGLExtensions().hasProgramBinary;
+    }
+
+    std::string getKey(const std::string& vertexCode, const std::string& fragmentCode) {
+        init();
+        // FNV-1a, std::hash isn't guaranteed to be the same between runs
+        uint64_t hash = 14695981039346656037ull;
+        const std::string* sources[] = { &driver, &vertexCode, &fragmentCode };
+        for (const std::string* s : sources) {
+            for (unsigned char c : *s) {
+                hash = (hash ^ c) * 1099511628211ull;
+            }
+            hash = (hash ^ 0xff) * 1099511628211ull; // Separator, so moving code between stages changes the key
+        }
+        char key[17];
+        std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+        return key;
+    }
+
+    /**
+     * Tries to load the program from disk, returns false if it has to be compiled
+     */
+    bool load(GLuint program, const std::string& key) {
+        if (!enabled || !isSupported()) { return false; }
+        std::ifstream file(directory + key + ".bin", std::ios::binary);
+        if (!file) { return false; }
+
+        GLenum format = 0;
+        if (!file.read(reinterpret_cast<char*>(&format), sizeof(format))) { return false; }
+        std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (binary.empty()) { return false; }
+        // An unknown format would be a GL error instead of a failed link
+        if (std::find(formats.begin(), formats.end(), GLint(format)) == formats.end()) { return false; }
+
+        getGLExtensions().programBinary(program, format, binary.data(), GLsizei(binary.size()));
+        while (glGetError() != GL_NO_ERROR) {} // A rejected binary isn't an error for us
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (success) { loaded++; }
+        return success != 0;
+    }
+
+    /**
+     * Has to be called before linking, so the driver keeps the binary around
+     */
+    void prepare(GLuint program) {
+        if (!enabled || !isSupported()) { return; }
+        getGLExtensions().programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    void store(GLuint program, const std::string& key) {
+        compiled++;
+        if (!enabled || !isSupported()) { return; }
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) { return; }
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        getGLExtensions().getProgramBinary(program, length, nullptr, &format, binary.data());
+
+        makeDirectory(directory);
+        std::ofstream file(directory + key + ".bin", std::ios::binary);
+        if (!file) {
+            std::cerr << "Can't write the program cache to " << directory << "\n";
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+        file.write(binary.data(), binary.size());
+    }
+
+    int getLoaded() const { return loaded; }
+    int getCompiled() const { return compiled; }
+
+private:
+    void init() {
+        if (initialized) { return; }
+        initialized = true;
+        for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+            const GLubyte* s = glGetString(name);
+            driver += s != nullptr ? reinterpret_cast<const char*>(s) : "";
+            driver += "\n";
+        }
+        if (getGLExtensions().hasProgramBinary) {
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+            formats.resize(count);
+            glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+        }
+    }
+};
+
+inline ProgramCache& getProgramCache() {
+    static ProgramCache cache;
+    return cache;
+}
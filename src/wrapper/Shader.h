@@ -7,44 +7,164 @@
 #include <sstream>
 #include <iostream>
 #include <regex>
+#include <vector>
 
 #include "Texture.h"
 #include "FrameBufferObject.h"
+#include "ProgramCache.h"
+#include "ShaderReloader.h"
+#include "../util/Profiler.h"
 
 #define GLSL(shader)  "#version 330 core\n" #shader
+#define GLSL_CHUNK(shader) #shader "\n"
 
 class Shader {
     GLuint sId;
 
+    /**
+     * Compiling and linking is only issued in the constructor, drivers with
+     * parallel compilation work on it in the background. The status is checked on first use
+     */
+    mutable bool finished = true;
+    mutable bool linked = true;
+    GLuint stages[2] = {};
+    std::string file;
+    std::string cacheKey;
+    mutable std::vector<std::pair<std::string, GLuint>> blockBindings; // Applied once it's linked and after reloads
+    std::unique_ptr<Shader> reloaded; // Compiling new code for the hot reload
+    bool reloadable = false; // Registered with the ShaderReloader
+
 public:
     NO_COPY(Shader)
 
-    Shader(std::string vertexCode, std::string fragmentCode, std::string file = "") { 	
-        if (vertexCode.find(".vert") != std::string::npos) {
-            vertexCode = readFile(vertexCode);
+    /**
+     * The code or paths to .vert and .frag files, file is the source file for error messages
+     * A name makes embedded code hot reloadable, it's edited in getEditablePath(file, name)
+     */
+    Shader(std::string vertexCode, std::string fragmentCode, std::string file = "", std::string name = "") : file(file) {
+        PROFILE_SCOPE("Shader::Shader");
+        const std::string vertexPath = vertexCode.find(".vert") != std::string::npos ? vertexCode : "";
+        const std::string fragmentPath = fragmentCode.find(".frag") != std::string::npos ? fragmentCode : "";
+        if (!vertexPath.empty()) {
+            vertexCode = readFile(vertexPath);
+        }
+        if (!fragmentPath.empty()) {
+            fragmentCode = readFile(fragmentPath);
+        }
+        // Shaders from files reload when one of them changes
+        for (const std::string& path : { vertexPath, fragmentPath }) {
+            if (path.empty()) { continue; }
+            reloadable = true;
+            getShaderReloader().add(this, path, nullptr, [this, vertexPath, fragmentPath, vertexCode, fragmentCode](const std::string&) {
+                reload(
+                    vertexPath.empty() ? vertexCode : readFile(vertexPath),
+                    fragmentPath.empty() ? fragmentCode : readFile(fragmentPath)
+                );
+            });
         }
-        if (fragmentCode.find(".frag") != std::string::npos) {
-            fragmentCode = readFile(fragmentCode);
+        if (fragmentPath.empty() && !file.empty() && !name.empty()) {
+            reloadable = true;
+            getShaderReloader().add(
+                this, getShaderReloader().getEditablePath(file, name),
+                [fragmentCode]() { return fragmentCode; },
+                [this, vertexCode](const std::string& code) { reload(vertexCode, code); }
+            );
         }
         
         sId = glCreateProgram();
 
+        ProgramCache& cache = getProgramCache();
+        cacheKey = cache.getKey(vertexCode, fragmentCode);
+        if (cache.load(sId, cacheKey)) { return; }
+
         auto loadShader = [&](const std::string& shader, unsigned int type) {
             const unsigned int sid = glCreateShader(type);
             const char* shaderChar = shader.c_str();
             glShaderSource(sid, 1, &shaderChar, nullptr);
             glCompileShader(sid);
-            checkCompileErrors(sid, std::to_string(type), file);
             glAttachShader(sId, sid);
-            glDeleteShader(sid);
+            return sid;
         };
 
-        loadShader(vertexCode, GL_VERTEX_SHADER);
-        loadShader(fragmentCode, GL_FRAGMENT_SHADER);
+        stages[0] = loadShader(vertexCode, GL_VERTEX_SHADER);
+        stages[1] = loadShader(fragmentCode, GL_FRAGMENT_SHADER);
 
+        cache.prepare(sId);
         glLinkProgram(sId);
-        
-        if (!checkCompileErrors(sId, "PROGRAM", file)) { return; }
+        finished = false;
+    }
+
+    ~Shader() {
+        // Only if it used the reloader, which then also outlives static shaders
+        if (reloadable) { getShaderReloader().remove(this); }
+    }
+
+    /**
+     * False while the driver is still compiling in the background
+     * Without parallel compilation there's no way to tell, using it just waits
+     */
+    bool isReady() const {
+        if (finished || !getGLExtensions().hasParallelCompile) { return true; }
+        GLint done = 0;
+        glGetProgramiv(sId, GL_COMPLETION_STATUS_KHR, &done);
+        return done != 0;
+    }
+
+    /**
+     * Waits for the compilation, reports errors and stores it in the program cache
+     * Done by the first use(), there's no need to call it by hand
+     */
+    void finish() const {
+        if (finished) { return; }
+        PROFILE_SCOPE("Shader::finish");
+        finished = true;
+        bool success = checkCompileErrors(stages[0], std::to_string(GL_VERTEX_SHADER), file);
+        success = checkCompileErrors(stages[1], std::to_string(GL_FRAGMENT_SHADER), file) && success;
+        glDeleteShader(stages[0]);
+        glDeleteShader(stages[1]);
+        linked = success && checkCompileErrors(sId, "PROGRAM", file);
+        if (!linked) { return; }
+        getProgramCache().store(sId, cacheKey);
+        for (auto& block : blockBindings) {
+            bindBlock(block.first, block.second);
+        }
+    }
+
+    /**
+     * Compiles new code next to the current program, which is swapped once it's linked
+     */
+    void reload(const std::string& vertexCode, const std::string& fragmentCode) {
+        if (reloaded != nullptr) { // Saved again before it was done
+            if (!reloaded->finished) {
+                glDeleteShader(reloaded->stages[0]);
+                glDeleteShader(reloaded->stages[1]);
+            }
+            glDeleteProgram(reloaded->sId);
+        }
+        reloaded.reset(new Shader(vertexCode, fragmentCode, file));
+        reloadable = true;
+        getShaderReloader().addPending(this, [this]() { return applyReload(); });
+    }
+
+    /**
+     * True once the reload is done, if the new code didn't compile the old program stays
+     */
+    bool applyReload() {
+        if (reloaded == nullptr) { return true; }
+        if (!reloaded->isReady()) { return false; }
+        finish();
+        reloaded->finish();
+        if (reloaded->linked) {
+            std::swap(sId, reloaded->sId);
+            for (auto& block : blockBindings) {
+                bindBlock(block.first, block.second);
+            }
+            std::cout << "Reloaded " << file << "\n";
+        }
+        if (currentProgram() == reloaded->sId) { currentProgram() = 0; }
+        glDeleteProgram(reloaded->sId);
+        reloaded.reset();
+        return true;
     }
 
     void use(const Textures &textures) const {
@@ -55,14 +175,11 @@ public:
      * Use the shaders and make the textures usable in the shader if needed
      */
     void use(const Textures* textures = nullptr) const {
-        /**
-         * The currently active program
-         * Used to avoid switching shader if not needed
-         */
-        static unsigned int currentId = 0;
-        if (currentId != sId) {
+        finish();
+
+        if (currentProgram() != sId) {
             glUseProgram(sId);
-            currentId = sId;
+            currentProgram() = sId;
         }
         
         if (textures != nullptr) {
@@ -78,6 +195,23 @@ public:
         }
     }
 
+    /**
+     * Binds a single texture to a sampler which doesn't need to have the name of the texture
+     */
+    void setTexture(const std::string &name, const std::shared_ptr<Texture> &texture, int unit) const {
+        setInt(name, unit);
+        GLC(glActiveTexture(GL_TEXTURE0 + unit));
+        texture->use();
+    }
+
+    /**
+     * Connects a uniform block of the shader to the binding point of an UniformBuffer
+     */
+    void bindUniformBlock(const std::string &name, GLuint binding) const {
+        blockBindings.emplace_back(name, binding);
+        if (finished) { bindBlock(name, binding); }
+    }
+
     GLuint getId() const { return sId; }
     
     void setBool(const std::string &name, bool value) const {
@@ -99,6 +233,10 @@ public:
         glUniform2f(glGetUniformLocation(sId, name.c_str()), x, y); 
     }
     
+    void setIVec2(const std::string &name, int x, int y) const {
+        glUniform2i(glGetUniformLocation(sId, name.c_str()), x, y);
+    }
+    
     void setVec3(const std::string &name, const glm::vec3 &value) const { 
         glUniform3fv(glGetUniformLocation(sId, name.c_str()), 1, &value[0]); 
     }
@@ -139,7 +277,32 @@ public:
         );
     }
 
+    /**
+     * Inserts a chunk of GLSL code right after the #version directive,
+     * so shaders can share functions and declarations
+     */
+    static std::string include(std::string code, const std::string& chunk) {
+        const size_t lineEnd = code.find('\n');
+        code.insert(lineEnd == std::string::npos ? 0 : lineEnd + 1, chunk);
+        return code;
+    }
+
 private:
+    /**
+     * The currently active program
+     * Used to avoid switching shader if not needed
+     */
+    static GLuint& currentProgram() {
+        static GLuint currentId = 0;
+        return currentId;
+    }
+
+    void bindBlock(const std::string &name, GLuint binding) const {
+        const GLuint index = glGetUniformBlockIndex(sId, name.c_str());
+        if (index == GL_INVALID_INDEX) { return; } // Not used by the shader
+        GLC(glUniformBlockBinding(sId, index, binding));
+    }
+
     static std::string readFile(const std::string& path) {
         try {
             std::ifstream file;
@@ -0,0 +1,97 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <functional>
+#include <cassert>
+
+#include "Shader.h"
+
+/**
+ * Name and GLSL value of every define of a shader variant
+ */
+using ShaderDefines = std::map<std::string, std::string>;
+
+/**
+ * Variants of one shader with different defines, compiled lazily on first use and cached
+ * GLSL() can't hold preprocessor directives, so the shader code uses the defines like constants
+ * The defaults map them to the runtime uniforms, which is the generic variant
+ * A specialised variant sets them to literals, so loops get a fixed count and can be unrolled
+ * and disabled features are removed by the compiler
+ */
+class ShaderPermutations {
+    std::string vertexCode;
+    std::string fragmentCode;
+    std::string file;
+    ShaderDefines defaults;
+    std::function<void(const Shader&)> setup; // Runs once per variant, e.g. to bind uniform blocks
+    std::map<ShaderDefines, std::unique_ptr<Shader>> variants;
+
+public:
+    NO_COPY(ShaderPermutations)
+
+    ShaderPermutations(
+        std::string vertexCode, std::string fragmentCode, ShaderDefines defaults,
+        std::string file = "", std::function<void(const Shader&)> setup = nullptr
+    ) : vertexCode(std::move(vertexCode)), fragmentCode(std::move(fragmentCode)), file(std::move(file)),
+        defaults(std::move(defaults)), setup(std::move(setup)) {
+        if (this->file.empty()) { return; }
+        // The edited code replaces the fragment shader of every variant, the defines stay
+        getShaderReloader().add(
+            this, getShaderReloader().getEditablePath(this->file),
+            [this]() { return this->fragmentCode; },
+            [this](const std::string& code) {
+                this->fragmentCode = code;
+                for (auto& variant : variants) {
+                    variant.second->reload(this->vertexCode, Shader::include(code, getDefineChunk(variant.first)));
+                }
+            }
+        );
+    }
+
+    ~ShaderPermutations() {
+        if (!file.empty()) { getShaderReloader().remove(this); }
+    }
+
+    /**
+     * The variant with the given defines replaced, everything not given keeps its default
+     */
+    Shader& get(const ShaderDefines& defines = {}) {
+        ShaderDefines merged = defaults;
+        for (auto& define : defines) {
+            assert(defaults.count(define.first) && "Unknown define");
+            merged[define.first] = define.second;
+        }
+
+        std::unique_ptr<Shader>& shader = variants[merged];
+        if (shader != nullptr) { return *shader; }
+
+        shader.reset(new Shader(vertexCode, Shader::include(fragmentCode, getDefineChunk(merged)), file));
+        if (setup) { setup(*shader); }
+        return *shader;
+    }
+
+    /**
+     * Like get(), but the generic variant stands in while the requested one still compiles
+     * Settings can change every frame, so this never waits for a new variant
+     */
+    Shader& getReady(const ShaderDefines& defines) {
+        Shader& variant = get(defines);
+        return variant.isReady() ? variant : get();
+    }
+
+    /**
+     * How many variants got compiled so far
+     */
+    size_t size() const { return variants.size(); }
+
+    static std::string getDefineChunk(const ShaderDefines& defines) {
+        std::string chunk;
+        for (auto& define : defines) {
+            chunk += "#define " + define.first + " " + define.second + "\n";
+        }
+        return chunk;
+    }
+
+    static std::string toDefine(int value) { return std::to_string(value); }
+    static std::string toDefine(bool value) { return value ? "true" : "false"; }
+};
@@ -0,0 +1,197 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#include "../util/FileWatcher.h"
+#include "../util/Util.h"
+
+/**
+ * Hot reload for shaders, off until setEnabled() is called
+ * Every shader registers the file its code can be edited in. Shaders embedded with GLSL()
+ * write their code there when it's enabled, comments are lost to the macro though
+ * Saving a file recompiles the shader, it keeps the old program until the new one is linked
+ * and if the new one doesn't compile. Enabling it overwrites files left from an earlier session
+ * Everything is registered with an owner, which has to call remove() before it goes away
+ */
+class ShaderReloader {
+    struct Source {
+        const void* owner = nullptr;
+        int id = 0; // Stays the same when others get removed, unlike the index
+        std::string path;
+        std::function<std::string()> exportCode; // Null if the file comes from somewhere else
+        std::function<void(const std::string&)> onChange;
+        std::string code; // Last seen content, writing the same again doesn't reload
+    };
+    std::vector<Source> sources;
+    std::vector<std::pair<const void*, std::function<bool()>>> pending;
+    std::unique_ptr<FileWatcher> watcher;
+    int nextId = 0;
+
+public:
+    NO_COPY(ShaderReloader)
+    ShaderReloader() = default;
+
+    std::string directory = platformPath("shaders/");
+
+    bool isEnabled() const { return watcher != nullptr; }
+
+    void setEnabled(bool enabled) {
+        if (enabled == isEnabled()) { return; }
+        if (!enabled) {
+            watcher.reset();
+            return;
+        }
+        watcher.reset(new FileWatcher());
+        makeDirectory(directory);
+        for (Source& source : sources) {
+            start(source);
+        }
+    }
+
+    /**
+     * Where an embedded shader from the given source file can be edited
+     * The name tells shaders from the same file apart, e.g. PostShader.lensMap.frag
+     */
+    std::string getEditablePath(const std::string& sourceFile, const std::string& name = "") const {
+        const size_t slash = sourceFile.find_last_of("/\\");
+        std::string stem = slash == std::string::npos ? sourceFile : sourceFile.substr(slash + 1);
+        stem = stem.substr(0, stem.find_last_of('.'));
+        return directory + stem + (name.empty() ? "" : "." + name) + ".frag";
+    }
+
+    void add(
+        const void* owner, const std::string& path, std::function<std::string()> exportCode,
+        std::function<void(const std::string&)> onChange
+    ) {
+        Source source;
+        source.owner = owner;
+        source.id = nextId++;
+        source.path = path;
+        source.exportCode = std::move(exportCode);
+        source.onChange = std::move(onChange);
+        sources.push_back(std::move(source));
+        if (isEnabled()) { start(sources.back()); }
+    }
+
+    /**
+     * Polled by update() until it returns true, used to wait for the compilation of reloaded shaders
+     */
+    void addPending(const void* owner, std::function<bool()> task) {
+        pending.emplace_back(owner, std::move(task));
+    }
+
+    /**
+     * Drops everything the owner added, its files just aren't reloaded anymore
+     */
+    void remove(const void* owner) {
+        sources.erase(std::remove_if(sources.begin(), sources.end(), [owner](const Source& source) {
+            return source.owner == owner;
+        }), sources.end());
+        pending.erase(std::remove_if(pending.begin(), pending.end(), [owner](const auto& task) {
+            return task.first == owner;
+        }), pending.end());
+    }
+
+    /**
+     * Call once per frame outside of any rendering
+     */
+    void update() {
+        if (watcher != nullptr) { watcher->poll(); }
+        for (size_t i = 0; i < pending.size();) {
+            if (pending[i].second()) {
+                pending.erase(pending.begin() + i);
+            } else {
+                i++;
+            }
+        }
+    }
+
+    static std::string readFile(const std::string& path) {
+        std::ifstream file(path);
+        std::stringstream stream;
+        stream << file.rdbuf();
+        return stream.str();
+    }
+
+    /**
+     * Stringifying in GLSL() puts everything on one line, this gives it lines and indentation back
+     */
+    static std::string formatGlsl(const std::string& code) {
+        std::string result;
+        std::string current;
+        int depth = 0, parens = 0;
+        const auto newline = [&]() {
+            const size_t start = current.find_first_not_of(' ');
+            if (start != std::string::npos) {
+                result += std::string(depth * 4, ' ') + current.substr(start) + "\n";
+            }
+            current.clear();
+        };
+
+        std::istringstream lines(code);
+        std::string line;
+        while (std::getline(lines, line)) {
+            if (line.find_first_not_of(' ') != std::string::npos && line[line.find_first_not_of(' ')] == '#') {
+                result += line + "\n"; // Preprocessor directives have to stay on their own line
+                continue;
+            }
+            for (size_t i = 0; i < line.size(); i++) {
+                const char c = line[i];
+                if (c == '(') { parens++; }
+                if (c == ')') { parens--; }
+                if (c == '{') {
+                    current += c;
+                    newline();
+                    depth++;
+                    continue;
+                }
+                if (c == '}') {
+                    newline();
+                    depth = std::max(0, depth - 1);
+                    current += c;
+                    // Keep "} else" and "};" together
+                    const size_t next = line.find_first_not_of(' ', i + 1);
+                    const bool joined = next != std::string::npos &&
+                        (line[next] == ';' || line.compare(next, 4, "else") == 0);
+                    if (!joined) { newline(); }
+                    continue;
+                }
+                current += c;
+                if (c == ';' && parens == 0) { newline(); }
+            }
+            newline();
+        }
+        return result;
+    }
+
+private:
+    void start(Source& source) {
+        if (source.exportCode) {
+            // The code that's running, edits from an earlier session don't come back by surprise
+            std::ofstream(source.path) << formatGlsl(source.exportCode());
+        }
+        source.code = readFile(source.path);
+        const int id = source.id;
+        watcher->watch(source.path, [this, id]() {
+            auto found = std::find_if(sources.begin(), sources.end(), [id](const Source& s) { return s.id == id; });
+            if (found == sources.end()) { return; } // Removed in the meantime
+            const std::string code = readFile(found->path);
+            // Some editors truncate first and write after
+            if (code.empty() || code == found->code) { return; }
+            found->code = code;
+            std::cout << "Reloading " << found->path << "\n";
+            found->onChange(code);
+        });
+    }
+};
+
+inline ShaderReloader& getShaderReloader() {
+    static ShaderReloader reloader;
+    return reloader;
+}
@@ -43,6 +43,14 @@ public:
         return name;
     }
 
+    /**
+     * Integer textures need an usampler in the shader and can't be filtered
+     */
+    bool isInteger() const {
+        return config.format == GL_RED_INTEGER || config.format == GL_RG_INTEGER ||
+            config.format == GL_RGB_INTEGER || config.format == GL_RGBA_INTEGER;
+    }
+
     void use() const {
         GLC(glBindTexture(config.target, texId));
     }
@@ -72,6 +80,9 @@ public:
     }
 
     GLuint getId() const { return texId; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    const TextureConfig& getConfig() const { return config; }
 };
 
 typedef std::vector<std::shared_ptr<Texture>> Textures;
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+#include "glad/glad.h"
+#include <cassert>
+#include <vector>
+#include <cstring>
+#include "../util/Util.h"
+#include "FramePacer.h"
+
+/**
+ * A buffer for std140 uniform blocks which stays bound to a fixed binding point
+ * Use Shader::bindUniformBlock() to connect the block of a shader to it
+ * With more than one copy an update goes into a copy no frame in flight reads anymore
+ * (known from the FramePacer), so it's written without waiting for the GPU.
+ * FramePacer::MAX_FRAMES + 1 copies are always enough
+ */
+class UniformBuffer {
+    GLuint bufferId = 0;
+    GLuint binding = 0;
+    size_t size = 0;
+    size_t stride = 0; // Copies start at a multiple of the uniform buffer alignment
+    int current = 0;
+    std::vector<long long> lastUsed; // Last frame of the FramePacer every copy was bound in
+
+public:
+    NO_COPY(UniformBuffer)
+
+    UniformBuffer(size_t bytes, GLuint bindingPoint, int copies = 1) : binding(bindingPoint), size(bytes),
+        lastUsed(copies, -1) {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        stride = (size + alignment - 1) / alignment * alignment;
+
+        GLC(glGenBuffers(1, &bufferId));
+        GLC(glBindBuffer(GL_UNIFORM_BUFFER, bufferId));
+        GLC(glBufferData(GL_UNIFORM_BUFFER, stride * copies, nullptr, GL_DYNAMIC_DRAW));
+        bind();
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    ~UniformBuffer() {
+        if (bufferId != 0) {
+            GLC(glDeleteBuffers(1, &bufferId));
+        }
+    }
+
+    /**
+     * Replaces a part of the buffer, the data has to follow the std140 layout
+     */
+    void update(const void* data, size_t bytes, size_t offset = 0) {
+        assert(offset + bytes <= size);
+        const int target = findFreeCopy();
+        GLC(glBindBuffer(GL_UNIFORM_BUFFER, bufferId));
+        if (target < 0) {
+            // Every other copy might still be read, the driver has to sync
+            GLC(glBufferSubData(GL_UNIFORM_BUFFER, current * stride + offset, bytes, data));
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            return;
+        }
+
+        // The rest comes from the current copy. Copied on the GPU and only around
+        // the new part, so it can't overwrite what's written from here
+        GLC(glBindBuffer(GL_COPY_READ_BUFFER, bufferId));
+        if (offset > 0) {
+            GLC(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_UNIFORM_BUFFER, current * stride, target * stride, offset));
+        }
+        if (offset + bytes < size) {
+            GLC(glCopyBufferSubData(
+                GL_COPY_READ_BUFFER, GL_UNIFORM_BUFFER,
+                current * stride + offset + bytes, target * stride + offset + bytes, size - offset - bytes
+            ));
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        if (bytes > 0) {
+            void* mapped = glMapBufferRange(
+                GL_UNIFORM_BUFFER, target * stride + offset, bytes,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT
+            );
+            if (mapped != nullptr) {
+                std::memcpy(mapped, data, bytes);
+                glUnmapBuffer(GL_UNIFORM_BUFFER);
+            } else {
+                GLC(glBufferSubData(GL_UNIFORM_BUFFER, target * stride + offset, bytes, data));
+            }
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        lastUsed[current] = getFramePacer().getFrame(); // This frame might have drawn with it already
+        current = target;
+        bind();
+    }
+
+    /**
+     * Only needed if something else took over the binding point
+     */
+    void bind() const {
+        GLC(glBindBufferRange(GL_UNIFORM_BUFFER, binding, bufferId, current * stride, size));
+    }
+
+    GLuint getBinding() const { return binding; }
+
+private:
+    /**
+     * A copy no frame in flight reads, -1 if there's none
+     */
+    int findFreeCopy() const {
+        const long long completed = getFramePacer().getCompletedFrame();
+        for (int i = 1; i < int(lastUsed.size()); i++) {
+            const int copy = (current + i) % int(lastUsed.size());
+            if (lastUsed[copy] <= completed) { return copy; }
+        }
+        return -1;
+    }
+};